@@ -35,6 +35,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "dstrings.h"
 #include "hu_stuff.h"
 #include "i_gamepad.h"
+#include "m_bbox.h"
 #include "p_local.h"
 #include "SDL.h"
 #include "st_stuff.h"
@@ -276,6 +277,20 @@ static boolean  movement = false;
 int             keydown;
 int             direction;
 
+// Lines are indexed by the cells of a coarse grid over the map that their
+//  bounding boxes touch, so AM_drawWalls only needs to look at the lines
+//  near the window when zoomed in. The grid is in PU_LEVEL, and is built
+//  again if it has been freed.
+#define LINEGRIDSHIFT   8                       // cells are 256 map units square
+
+static int      *linegrid;                      // first line in each cell, then the lines
+static int      *linegridlines;
+static int      *linegridvisible;               // lines found for the current window
+static int      linegridx;
+static int      linegridy;
+static int      linegridwidth;
+static int      linegridheight;
+
 __inline static int sign(int a)
 {
     return (a > 0) - (a < 0);
@@ -388,6 +403,98 @@ void AM_findMinMaxBoundaries(void)
     max_scale_mtof = FixedDiv(MAPHEIGHT << FRACBITS, PLAYERRADIUS << 1);
 }
 
+//
+// Finds the cells of the line grid that a line's bounding box touches.
+//
+static void AM_lineGridCells(line_t *line, int *x1, int *y1, int *x2, int *y2)
+{
+    fixed_t *bbox = line->bbox;
+
+    *x1 = ((bbox[BOXLEFT] >> FRACBITS) - linegridx) >> LINEGRIDSHIFT;
+    *x2 = ((bbox[BOXRIGHT] >> FRACBITS) - linegridx) >> LINEGRIDSHIFT;
+    *y1 = ((bbox[BOXBOTTOM] >> FRACBITS) - linegridy) >> LINEGRIDSHIFT;
+    *y2 = ((bbox[BOXTOP] >> FRACBITS) - linegridy) >> LINEGRIDSHIFT;
+}
+
+//
+// Builds the grid of cells used to find which lines are in the window.
+//
+static void AM_buildLineGrid(void)
+{
+    int i;
+    int minx = 0, miny = 0;
+    int maxx = 0, maxy = 0;
+    int numcells;
+    int total = 0;
+
+    if (linegrid)
+        Z_Free(linegrid);
+
+    for (i = 0; i < numlines; ++i)
+    {
+        fixed_t *bbox = lines[i].bbox;
+
+        if (!i || (bbox[BOXLEFT] >> FRACBITS) < minx)
+            minx = bbox[BOXLEFT] >> FRACBITS;
+        if (!i || (bbox[BOXRIGHT] >> FRACBITS) > maxx)
+            maxx = bbox[BOXRIGHT] >> FRACBITS;
+        if (!i || (bbox[BOXBOTTOM] >> FRACBITS) < miny)
+            miny = bbox[BOXBOTTOM] >> FRACBITS;
+        if (!i || (bbox[BOXTOP] >> FRACBITS) > maxy)
+            maxy = bbox[BOXTOP] >> FRACBITS;
+    }
+
+    linegridx = minx;
+    linegridy = miny;
+    linegridwidth = ((maxx - minx) >> LINEGRIDSHIFT) + 1;
+    linegridheight = ((maxy - miny) >> LINEGRIDSHIFT) + 1;
+    numcells = linegridwidth * linegridheight;
+
+    for (i = 0; i < numlines; ++i)
+    {
+        int x1, y1, x2, y2;
+
+        AM_lineGridCells(&lines[i], &x1, &y1, &x2, &y2);
+        total += (x2 - x1 + 1) * (y2 - y1 + 1);
+    }
+
+    // one block holds where each cell's lines start, the lines in each
+    //  cell, and room to gather the lines in the window
+    linegrid = (int *)Z_Calloc(numcells + 1 + total * 2, sizeof(int), PU_LEVEL,
+                               (void **)&linegrid);
+    linegridlines = linegrid + numcells + 1;
+    linegridvisible = linegridlines + total;
+
+    // count the lines in each cell
+    for (i = 0; i < numlines; ++i)
+    {
+        int x1, y1, x2, y2;
+        int x, y;
+
+        AM_lineGridCells(&lines[i], &x1, &y1, &x2, &y2);
+        for (y = y1; y <= y2; ++y)
+            for (x = x1; x <= x2; ++x)
+                ++linegrid[y * linegridwidth + x + 1];
+    }
+    for (i = 0; i < numcells; ++i)
+        linegrid[i + 1] += linegrid[i];
+
+    // fill in each cell's lines, which leaves linegrid[cell] at the end
+    //  of that cell's lines, so move them back down again after
+    for (i = 0; i < numlines; ++i)
+    {
+        int x1, y1, x2, y2;
+        int x, y;
+
+        AM_lineGridCells(&lines[i], &x1, &y1, &x2, &y2);
+        for (y = y1; y <= y2; ++y)
+            for (x = x1; x <= x2; ++x)
+                linegridlines[linegrid[y * linegridwidth + x]++] = i;
+    }
+    memmove(linegrid + 1, linegrid, numcells * sizeof(*linegrid));
+    linegrid[0] = 0;
+}
+
 void AM_changeWindowLoc(void)
 {
     fixed_t w = (m_w >> 1);
@@ -536,6 +643,7 @@ void AM_LevelInit(void)
     bigstate = false;
 
     AM_findMinMaxBoundaries();
+    AM_buildLineGrid();
     scale_mtof = 0x2ba0;
     scale_ftom = FixedDiv(FRACUNIT, scale_mtof);
 
@@ -1358,77 +1466,128 @@ static void AM_drawGrid(void)
 }
 
 //
-// Determines visible lines, draws them.
-// This is LineDef based, not LineSeg based.
+// Draws a line in the color for what kind of line it is.
 //
-static void AM_drawWalls(void)
+static void AM_drawWall(line_t *line, boolean allmap, boolean cheating)
 {
-    boolean allmap = plr->powers[pw_allmap];
-    boolean cheating = (plr->cheats & (CF_ALLMAP | CF_ALLMAP_THINGS));
-    int     i = 0;
+    short  flags = line->flags;
 
-    while (i < numlines)
+    if ((flags & ML_DONTDRAW) && !cheating)
+        return;
+    else
     {
-        line_t *line = &lines[i++];
-        short  flags = line->flags;
-
-        if ((flags & ML_DONTDRAW) && !cheating)
-            continue;
-        else
+        sector_t *backsector = line->backsector;
+        sector_t *frontsector = line->frontsector;
+        short    mapped = (flags & ML_MAPPED);
+        short    secret = (flags & ML_SECRET);
+        short    special = line->special;
+
+        if (special == W1_TeleportToTaggedSectorContainingTeleportLanding
+            || special == W1_ExitLevel
+            || special == WR_TeleportToTaggedSectorContainingTeleportLanding
+            || (special >= W1_ExitLevelAndGoToSecretLevel  
+                && special <= MR_TeleportToTaggedSectorContainingTeleportLanding))
         {
-            sector_t *backsector = line->backsector;
-            sector_t *frontsector = line->frontsector;
-            short    mapped = (flags & ML_MAPPED);
-            short    secret = (flags & ML_SECRET);
-            short    special = line->special;
-
-            if (special == W1_TeleportToTaggedSectorContainingTeleportLanding
-                || special == W1_ExitLevel
-                || special == WR_TeleportToTaggedSectorContainingTeleportLanding
-                || (special >= W1_ExitLevelAndGoToSecretLevel  
-                    && special <= MR_TeleportToTaggedSectorContainingTeleportLanding))
+            if (cheating || (mapped && !secret
+                && backsector->ceilingheight != backsector->floorheight))
             {
-                if (cheating || (mapped && !secret
-                    && backsector->ceilingheight != backsector->floorheight))
-                {
-                    AM_drawMline(line->v1->x, line->v1->y,
-                                 line->v2->x, line->v2->y, teleportercolor);
-                    continue;
-                }
-                else if (allmap)
-                {
-                    AM_drawMline(line->v1->x, line->v1->y,
-                                 line->v2->x, line->v2->y, allmapfdwallcolor);
-                    continue;
-                }
-            }
-            if (!backsector || (secret && !cheating))
-                AM_drawBigMline(line->v1->x, line->v1->y,
-                                line->v2->x, line->v2->y,
-                                (mapped || cheating ? wallcolor :
-                                    (allmap ? allmapwallcolor : maskcolor)));
-            else if (backsector->floorheight != frontsector->floorheight)
-            {
-                if (mapped || cheating)
-                    AM_drawMline(line->v1->x, line->v1->y,
-                                 line->v2->x, line->v2->y, fdwallcolor);
-                else if (allmap)
-                    AM_drawMline(line->v1->x, line->v1->y,
-                                 line->v2->x, line->v2->y, allmapfdwallcolor);
+                AM_drawMline(line->v1->x, line->v1->y,
+                             line->v2->x, line->v2->y, teleportercolor);
+                return;
             }
-            else if (backsector->ceilingheight != frontsector->ceilingheight)
+            else if (allmap)
             {
-                if (mapped || cheating)
-                    AM_drawMline(line->v1->x, line->v1->y,
-                                 line->v2->x, line->v2->y, cdwallcolor);
-                else if (allmap)
-                    AM_drawMline(line->v1->x, line->v1->y,
-                                 line->v2->x, line->v2->y, allmapcdwallcolor);
+                AM_drawMline(line->v1->x, line->v1->y,
+                             line->v2->x, line->v2->y, allmapfdwallcolor);
+                return;
             }
-            else if (cheating)
+        }
+        if (!backsector || (secret && !cheating))
+            AM_drawBigMline(line->v1->x, line->v1->y,
+                            line->v2->x, line->v2->y,
+                            (mapped || cheating ? wallcolor :
+                                (allmap ? allmapwallcolor : maskcolor)));
+        else if (backsector->floorheight != frontsector->floorheight)
+        {
+            if (mapped || cheating)
+                AM_drawMline(line->v1->x, line->v1->y,
+                             line->v2->x, line->v2->y, fdwallcolor);
+            else if (allmap)
                 AM_drawMline(line->v1->x, line->v1->y,
-                             line->v2->x, line->v2->y, tswallcolor);
+                             line->v2->x, line->v2->y, allmapfdwallcolor);
         }
+        else if (backsector->ceilingheight != frontsector->ceilingheight)
+        {
+            if (mapped || cheating)
+                AM_drawMline(line->v1->x, line->v1->y,
+                             line->v2->x, line->v2->y, cdwallcolor);
+            else if (allmap)
+                AM_drawMline(line->v1->x, line->v1->y,
+                             line->v2->x, line->v2->y, allmapcdwallcolor);
+        }
+        else if (cheating)
+            AM_drawMline(line->v1->x, line->v1->y,
+                         line->v2->x, line->v2->y, tswallcolor);
+    }
+}
+
+static int AM_compareLines(const void *a, const void *b)
+{
+    return (*(int *)a - *(int *)b);
+}
+
+//
+// Determines visible lines, draws them.
+// This is LineDef based, not LineSeg based.
+//
+static void AM_drawWalls(void)
+{
+    boolean allmap = plr->powers[pw_allmap];
+    boolean cheating = (plr->cheats & (CF_ALLMAP | CF_ALLMAP_THINGS));
+    int     margin = (FixedMul(2 << FRACBITS, scale_ftom) >> FRACBITS) + 1;
+    int     x1, y1, x2, y2;
+    int     i;
+
+    if (!linegrid)
+        AM_buildLineGrid();
+
+    // find the cells the window is in, allowing for lines that only just
+    //  touch its edges. The automap doesn't rotate, so the window is always
+    //  square to the grid.
+    x1 = MAX(0, ((m_x >> FRACBITS) - margin - linegridx) >> LINEGRIDSHIFT);
+    x2 = MIN(linegridwidth - 1, ((m_x2 >> FRACBITS) + margin - linegridx) >> LINEGRIDSHIFT);
+    y1 = MAX(0, ((m_y >> FRACBITS) - margin - linegridy) >> LINEGRIDSHIFT);
+    y2 = MIN(linegridheight - 1, ((m_y2 >> FRACBITS) + margin - linegridy) >> LINEGRIDSHIFT);
+
+    if (x1 > x2 || y1 > y2)
+    {
+        // the window is off the edge of the map
+    }
+    else if ((x2 - x1 + 1) * (y2 - y1 + 1) * 2 > linegridwidth * linegridheight)
+    {
+        // most of the map is in the window, so just draw every line
+        for (i = 0; i < numlines; ++i)
+            AM_drawWall(&lines[i], allmap, cheating);
+    }
+    else
+    {
+        int numvisible = 0;
+        int x, y;
+
+        for (y = y1; y <= y2; ++y)
+            for (x = x1; x <= x2; ++x)
+            {
+                int cell = y * linegridwidth + x;
+
+                for (i = linegrid[cell]; i < linegrid[cell + 1]; ++i)
+                    linegridvisible[numvisible++] = linegridlines[i];
+            }
+
+        // draw them in the same order as before, and only once each
+        qsort(linegridvisible, numvisible, sizeof(*linegridvisible), AM_compareLines);
+        for (i = 0; i < numvisible; ++i)
+            if (!i || linegridvisible[i] != linegridvisible[i - 1])
+                AM_drawWall(&lines[linegridvisible[i]], allmap, cheating);
     }
 
     if (!cheating && !allmap)
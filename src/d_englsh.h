@@ -140,6 +140,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 //
 #define GGSAVED                 "\"%s\" saved"
 #define GSCREENSHOT             "\"%s\" saved"
+#define GREWOUND                "Rewound %i second%s"
 
 //
 //  HU_stuff.C
@@ -68,7 +68,8 @@ typedef enum
     ga_victory,
     ga_worlddone,
     ga_screenshot,
-    ga_reloadgame
+    ga_reloadgame,
+    ga_rewind
 } gameaction_t;
 
 
@@ -42,6 +42,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "i_timer.h"
 #include "i_video.h"
 #include "m_argv.h"
+#include "m_bench.h"
 #include "m_config.h"
 #include "m_menu.h"
 #include "m_misc.h"
@@ -182,7 +183,7 @@ void D_Display(void)
     }
 
     // save the current screen if about to wipe
-    if (gamestate != wipegamestate)
+    if (gamestate != wipegamestate && !headless)
     {
         wipe = true;
         wipe_StartScreen();
@@ -200,7 +201,9 @@ void D_Display(void)
         case GS_LEVEL:
             if (!gametic)
                 break;
+            M_BenchStart(bench_hud);
             ST_Drawer(viewheight == SCREENHEIGHT, true);
+            M_BenchStop(bench_hud);
             break;
 
         case GS_INTERMISSION:
@@ -222,7 +225,9 @@ void D_Display(void)
         R_RenderPlayerView(&players[displayplayer]);
         if (automapactive)
             AM_Drawer();
+        M_BenchStart(bench_hud);
         HU_Drawer();
+        M_BenchStop(bench_hud);
     }
 
     // clean up border stuff
@@ -313,11 +318,16 @@ void D_DoomLoop(void)
     {
         TryRunTics(); // will run at least one tic
 
+        if (simdemo)
+            continue;
+
         S_UpdateSounds(players[consoleplayer].mo); // move positional sounds
 
         // Update display, next frame, with current state.
         if (screenvisible)
             D_Display();
+
+        M_BenchEndFrame();
     }
 }
 
@@ -637,10 +647,48 @@ static void D_DoomMainSetup(void)
 
     modifiedgame = false;
 
+    //!
+    // @category demo
+    //
+    // Run without opening a window, and without sound or music.
+    // Intended for timing demos with -timedemo.
+    //
+    headless = M_CheckParm("-headless");
+
+    //!
+    // @arg <demo>
+    // @category demo
+    //
+    // Play back the demo <demo>.lmp as fast as possible, without drawing
+    // it or playing any sound. When it ends, print a hash of the playsim
+    // for every tic, made the same way as for -statehash, to compare
+    // against other builds.
+    //
+    if (M_CheckParmWithArgs("-simdemo", 1))
+        headless = true;
+
     nomonsters = M_CheckParm("-nomonsters");
     respawnparm = M_CheckParm("-respawn");
     fastparm = M_CheckParm("-fast");
     devparm = M_CheckParm("-devparm");
+
+    //!
+    // @category video
+    //
+    // Show how many drawsegs, vissprites, openings and visplanes the
+    // last frame used, and the most any frame has used.
+    //
+    showrenderstats = M_CheckParm("-renderstats");
+
+    //!
+    // @category obscure
+    //
+    // Print how much zone memory each purge tag is using, the peak
+    // usage, how well freed blocks are being reused, how many mobjs
+    // have been spawned and how many sight checks were made, on exit.
+    //
+    zonestats = M_CheckParm("-zonestats");
+
     if (M_CheckParm("-altdeath"))
         deathmatch = 2;
     else if (M_CheckParm("-deathmatch"))
@@ -738,6 +786,9 @@ static void D_DoomMainSetup(void)
     if (!p)
         p = M_CheckParmWithArgs("-timedemo", 1);
 
+    if (!p)
+        p = M_CheckParmWithArgs("-simdemo", 1);
+
     if (p)
     {
         if (!strcasecmp(myargv[p + 1] + strlen(myargv[p + 1]) - 4, ".lmp"))
@@ -906,6 +957,9 @@ static void D_DoomMainSetup(void)
 
     AM_Init();
 
+    G_InitRewind();
+    G_InitStateHash();
+
     p = M_CheckParmWithArgs("-record", 1);
     if (p)
     {
@@ -924,10 +978,28 @@ static void D_DoomMainSetup(void)
     p = M_CheckParmWithArgs("-timedemo", 1);
     if (p)
     {
+        //!
+        // @arg <file>
+        // @category demo
+        //
+        // Write the time spent in each renderer and game stage for
+        // every frame of a -timedemo to a CSV file.
+        //
+        p = M_CheckParmWithArgs("-benchmark", 1);
+        if (p)
+            M_BenchInit(myargv[p + 1]);
+
         G_TimeDemo(demolumpname);
         D_DoomLoop();                           // never returns
     }
 
+    p = M_CheckParmWithArgs("-simdemo", 1);
+    if (p)
+    {
+        G_SimDemo(demolumpname);
+        D_DoomLoop();                           // never returns
+    }
+
     if (startloadgame >= 0)
     {
         strcpy(file, P_SaveGameFile(startloadgame));
@@ -33,6 +33,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "i_timer.h"
 #include "i_video.h"
 #include "g_game.h"
+#include "m_bench.h"
 #include "doomdef.h"
 #include "doomstat.h"
 
@@ -74,6 +75,10 @@ fixed_t         offsetms;
 
 boolean         net_cl_new_sync = true;
 
+// Run a single tic every frame, as fast as possible (-timedemo)
+
+boolean         singletics = false;
+
 // 35 fps clock adjusted by offsetms milliseconds
 
 static int GetAdjustedTime(void)
@@ -93,6 +98,55 @@ static int GetAdjustedTime(void)
     return (time_ms * TICRATE) / 1000;
 }
 
+//
+// BuildNewTic
+// Builds a single ticcmd for the console player.
+// Returns false if too many tics are already buffered.
+//
+static boolean BuildNewTic(void)
+{
+    int      gameticdiv;
+    ticcmd_t cmd;
+
+    gameticdiv = gametic / ticdup;
+
+    I_StartTic();
+    D_ProcessEvents();
+
+    // Always run the menu
+
+    M_Ticker();
+
+    if (net_cl_new_sync)
+    {
+        // If playing single player, do not allow tics to buffer
+        // up very far
+
+        if ((!netgame || demoplayback) && maketic - gameticdiv > 2)
+            return false;
+
+        // Never go more than ~200ms ahead
+
+        if (maketic - gameticdiv > 8)
+            return false;
+    }
+    else
+    {
+        if (maketic - gameticdiv >= 5)
+            return false;
+    }
+
+    memset(&cmd, 0, sizeof(ticcmd_t));
+    G_BuildTiccmd(&cmd, maketic);
+
+    netcmds[consoleplayer][maketic % BACKUPTICS] = cmd;
+
+    ++maketic;
+    nettics[consoleplayer] = maketic;
+
+    return true;
+}
+
 //
 // NetUpdate
 // Builds ticcmds for console player,
@@ -105,7 +159,12 @@ void NetUpdate(void)
     int nowtime;
     int newtics;
     int i;
-    int gameticdiv;
+
+    // If we are running with singletics (timing a demo), this
+    // is all done separately.
+
+    if (singletics)
+        return;
 
     // check time
     nowtime = GetAdjustedTime() / ticdup;
@@ -125,46 +184,9 @@ void NetUpdate(void)
     }
 
     // build new ticcmds for console player
-    gameticdiv = gametic / ticdup;
-
     for (i = 0; i < newtics; i++)
-    {
-        ticcmd_t cmd;
-
-        I_StartTic();
-        D_ProcessEvents();
-
-        // Always run the menu
-
-        M_Ticker();
-
-        if (net_cl_new_sync)
-        {
-            // If playing single player, do not allow tics to buffer
-            // up very far
-
-            if ((!netgame || demoplayback) && maketic - gameticdiv > 2)
-                break;
-
-            // Never go more than ~200ms ahead
-
-            if (maketic - gameticdiv > 8)
-                break;
-        }
-        else
-        {
-            if (maketic - gameticdiv >= 5)
-                break;
-        }
-
-        memset(&cmd, 0, sizeof(ticcmd_t));
-        G_BuildTiccmd(&cmd, maketic);
-
-        netcmds[consoleplayer][maketic % BACKUPTICS] = cmd;
-
-        ++maketic;
-        nettics[consoleplayer] = maketic;
-    }
+        if (!BuildNewTic())
+            break;
 }
 
 //
@@ -291,8 +313,13 @@ void TryRunTics(void)
     realtics = entertic - oldentertics;
     oldentertics = entertic;
 
-    // get available tics
-    NetUpdate();
+    // in singletics mode, run a single tic every time this function
+    // is called.
+
+    if (singletics)
+        BuildNewTic();
+    else
+        NetUpdate();
 
     lowtic = GetLowTic();
 
@@ -402,7 +429,11 @@ void TryRunTics(void)
             if (advancedemo)
                 D_DoAdvanceDemo();
 
+            G_CheckDemoSeek();
+
+            M_BenchStart(bench_ticker);
             G_Ticker();
+            M_BenchStop(bench_ticker);
             gametic++;
 
             // modify command for duplicated tics
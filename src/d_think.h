@@ -61,6 +61,15 @@ typedef union
 typedef actionf_t  think_t;
 
 
+// Thinkers are also kept in a list of their own class, so that
+//  mobjs can be found without going through every sector special.
+typedef enum
+{
+    th_mobj,
+    th_misc,
+    NUMTHCLASS
+} thclass_t;
+
 // Doubly linked list of actors.
 typedef struct thinker_s
 {
@@ -68,6 +77,16 @@ typedef struct thinker_s
     struct thinker_s    *next;
     think_t             function;
 
+    // links in the list for its class
+    struct thinker_s    *cprev;
+    struct thinker_s    *cnext;
+
+    // where it is in the thinker list, and when to wake it
+    //  if it has been put to sleep
+    unsigned int        order;
+    int                 wake;
+    struct thinker_s    *snext;
+
 } thinker_t;
 
 
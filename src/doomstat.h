@@ -198,6 +198,9 @@ extern boolean          usergame;
 extern boolean          demoplayback;
 extern boolean          demorecording;
 
+// A level is being loaded for a demo, before demoplayback is set.
+extern boolean          demoloading;
+
 // Round angleturn in ticcmds to the nearest 256.  This is used when
 // recording Vanilla demos in netgames.
 
@@ -206,6 +209,15 @@ extern boolean          demorecording;
 // Quit after playing a demo from cmdline.
 extern boolean          singledemo;
 
+// Run one tic per frame without waiting for the timer.
+extern boolean          singletics;
+
+// Exit with a report when the demo being timed ends.
+extern boolean          timingdemo;
+
+// Play a demo without drawing it, as fast as it can be played.
+extern boolean          simdemo;
+
 
 
 
@@ -285,6 +297,7 @@ extern int              skyflatnum;
 
 
 extern int              rndindex;
+extern int              prndindex;
 
 extern int              maketic;
 extern int              nettics[MAXPLAYERS];
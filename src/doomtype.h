@@ -48,4 +48,11 @@ typedef uint8_t byte;
 
 #define arrlen(array) (sizeof(array) / sizeof(*array))
 
+// Storage class for variables that each thread gets its own copy of.
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+
 #endif
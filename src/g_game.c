@@ -41,6 +41,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "i_timer.h"
 #include "i_video.h"
 #include "m_argv.h"
+#include "m_bench.h"
 #include "m_menu.h"
 #include "m_misc.h"
 #include "m_random.h"
@@ -57,8 +58,6 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "wi_stuff.h"
 #include "z_zone.h"
 
-#define SAVEGAMESIZE 0x2c0000
-
 void G_ReadDemoTiccmd(ticcmd_t *cmd);
 void G_WriteDemoTiccmd(ticcmd_t *cmd);
 void G_PlayerReborn(int player);
@@ -94,6 +93,7 @@ boolean         sendsave;               // send a save event next tic
 boolean         usergame;               // ok to save / end game
 
 boolean         timingdemo;             // if true, exit with report on completion
+boolean         simdemo;                // if true, don't draw the demo being timed
 int             starttime;              // for comparative timing purposes
 
 boolean         viewactive;
@@ -116,11 +116,13 @@ boolean         demorecording;
 boolean         longtics;               // cph's doom 1.91 longtics hack
 boolean         lowres_turn;            // low resolution turning for longtics
 boolean         demoplayback;
+boolean         demoloading;
 boolean         netdemo;
 boolean         longtics;
 byte            *demobuffer;
 byte            *demo_p;
 byte            *demoend;
+int             demotic;                // tics of the demo played back so far
 boolean         singledemo;             // quit after playing a demo from cmdline
 
 boolean         precache = true;        // if true, load all graphics at start
@@ -159,6 +161,7 @@ int             key_prevweapon = 0;
 int             key_nextweapon = 0;
 
 int             key_pause = KEY_PAUSE;
+int             key_rewind = KEY_BACKSPACE;
 int             key_demo_quit = 'q';
 
 int             mousebfire = 0;
@@ -577,6 +580,18 @@ void PrevWeapon(void)
 //
 boolean G_Responder(event_t *ev)
 {
+    // left and right arrows seek through demos
+    if (demoplayback && !menuactive && ev->type == ev_keydown
+        && (ev->data1 == KEY_LEFTARROW || ev->data1 == KEY_RIGHTARROW))
+    {
+        if (!keydown)
+        {
+            keydown = ev->data1;
+            G_DemoSeek(demotic + (ev->data1 == KEY_LEFTARROW ? -DEMOSEEKTICS : DEMOSEEKTICS));
+        }
+        return true;
+    }
+
     // any other key pops up menu if in demos
     if (gameaction == ga_nothing && !singledemo && (demoplayback || gamestate == GS_DEMOSCREEN))
     {
@@ -663,6 +678,11 @@ boolean G_Responder(event_t *ev)
                 keydown = key_pause;
                 sendpause = true;
             }
+            else if (ev->data1 == key_rewind && rewindinterval && !menuactive && !keydown)
+            {
+                keydown = key_rewind;
+                gameaction = ga_rewind;
+            }
             else if (ev->data1 < NUMKEYS)
             {
                 gamekeydown[ev->data1] = true;
@@ -730,6 +750,8 @@ boolean G_CheckSaveGame(void)
     int         mission;
     int         i;
 
+    P_WaitForSaveGame();
+
     handle = fopen(savename, "rb");
 
     for (i = 0; i < SAVESTRINGSIZE + VERSIONSIZE + 1; i++)
@@ -801,6 +823,9 @@ void G_Ticker(void)
             case ga_worlddone:
                 G_DoWorldDone();
                 break;
+            case ga_rewind:
+                G_DoRewind();
+                break;
             case ga_screenshot:
                 if (gametic)
                 {
@@ -889,6 +914,9 @@ void G_Ticker(void)
         }
     }
 
+    if (demoplayback || demorecording)
+        demotic++;
+
     // check for special buttons
     for (i = 0; i < MAXPLAYERS; i++)
     {
@@ -950,6 +978,11 @@ void G_Ticker(void)
             D_PageTicker();
             break;
     }
+
+    G_RewindTicker();
+
+    if (demoplayback || demorecording)
+        G_StateHashTicker();
 }
 
 //
@@ -1459,21 +1492,31 @@ void G_LoadGame(char *name)
 
 void G_DoLoadGame(void)
 {
-    int savedleveltime;
-    int i;
-
     gameaction = ga_nothing;
 
-    save_stream = fopen(savename, "rb");
+    P_WaitForSaveGame();
 
-    if (save_stream == NULL)
+    if (!P_OpenSaveGame(savename))
         return;
 
+    G_ClearRewind();
+    G_UnArchiveGame();
+}
+
+//
+// G_UnArchiveGame
+// Load the savegame opened with P_OpenSaveGame or P_OpenSaveGameBuffer.
+//
+void G_UnArchiveGame(void)
+{
+    int savedleveltime;
+    int i;
+
     savegame_error = false;
 
     if (!P_ReadSaveGameHeader())
     {
-        fclose(save_stream);
+        P_CloseSaveGame();
         return;
     }
 
@@ -1492,11 +1535,12 @@ void G_DoLoadGame(void)
     P_UnArchiveWorld();
     P_UnArchiveThinkers();
     P_UnArchiveSpecials();
+    P_UnArchiveMisc();
 
     if (!P_ReadSaveGameEOF())
         I_Error("Bad savegame");
 
-    fclose(save_stream);
+    P_CloseSaveGame();
 
     if (setsizeneeded)
         R_ExecuteSetViewSize();
@@ -1529,15 +1573,7 @@ void G_DoSaveGame(void)
     temp_savegame_file = P_TempSaveGameFile();
     savegame_file = P_SaveGameFile(savegameslot);
 
-    // Open the savegame file for writing.  We write to a temporary file
-    // and then rename it at the end if it was successfully written.
-    // This prevents an existing savegame from being overwritten by
-    // a corrupted one, or if a savegame buffer overrun occurs.
-
-    save_stream = fopen(temp_savegame_file, "wb");
-
-    if (save_stream == NULL)
-        return;
+    P_CreateSaveGame();
 
     savegame_error = false;
 
@@ -1547,21 +1583,17 @@ void G_DoSaveGame(void)
     P_ArchiveWorld();
     P_ArchiveThinkers();
     P_ArchiveSpecials();
+    P_ArchiveMisc();
 
     P_WriteSaveGameEOF();
 
-    if (ftell(save_stream) > SAVEGAMESIZE)
+    if (P_SaveGameLength() > SAVEGAMESIZE)
         I_Error("Savegame buffer overrun");
 
-    // Finish up, close the savegame file.
+    // Finish up, compress and write the savegame file in the background.
 
-    fclose(save_stream);
-
-    // Now rename the temporary savegame file to the actual savegame
-    // file, overwriting the old savegame if there was one there.
-
-    remove(savegame_file);
-    rename(temp_savegame_file, savegame_file);
+    if (!P_WriteSaveGame(temp_savegame_file, savegame_file))
+        return;
 
     // [BH] use the save description in the message displayed
     sprintf(buffer, GGSAVED, savedescription);
@@ -1637,6 +1669,7 @@ void G_DoNewGame(void)
 
     consoleplayer = 0;
     st_facecount = ST_STRAIGHTFACECOUNT; // [BH]
+    G_ClearRewind();
     G_InitNew(d_skill, d_episode, d_map);
     gameaction = ga_nothing;
     markpointnum = 0;   // [BH]
@@ -1916,6 +1949,7 @@ void G_BeginRecording(void)
     lowres_turn = !longtics;
 
     demo_p = demobuffer;
+    demotic = 0;
 
     // Save the right version code for this demo
 
@@ -1992,14 +2026,25 @@ static char *DemoVersionDescription(int version)
 }
 
 void G_DoPlayDemo(void)
+{
+    gameaction = ga_nothing;
+    G_ClearRewind();
+    demobuffer = (byte *)W_CacheLumpName(defdemoname, PU_STATIC);
+    G_RestartDemo();
+    starttime = I_GetTime();
+}
+
+//
+// G_RestartDemo
+// Play the demo in demobuffer from its start.
+//
+void G_RestartDemo(void)
 {
     skill_t     skill;
     int         i, episode, map;
     int demoversion;
 
-    gameaction = ga_nothing;
-    demobuffer = demo_p = (byte *)W_CacheLumpName(defdemoname, PU_STATIC);
-
+    demo_p = demobuffer;
     demoversion = *demo_p++;
 
     if (demoversion == DOOM_VERSION)
@@ -2046,12 +2091,25 @@ void G_DoPlayDemo(void)
 
     // don't spend a lot of time in loadlevel
     precache = false;
+    demoloading = true;
     G_InitNew(skill, episode, map);
+    demoloading = false;
     precache = true;
-    starttime = I_GetTime();
 
     usergame = false;
     demoplayback = true;
+    demotic = 0;
+}
+
+//
+// G_SimDemo
+// Time a demo without drawing it or playing any sound, and hash the
+//  game every tic.
+//
+void G_SimDemo(char *name)
+{
+    simdemo = true;
+    G_TimeDemo(name);
 }
 
 //
@@ -2060,6 +2118,7 @@ void G_DoPlayDemo(void)
 void G_TimeDemo(char *name)
 {
     timingdemo = true;
+    singletics = true;
 
     defdemoname = name;
     gameaction = ga_playdemo;
@@ -2079,6 +2138,8 @@ boolean G_CheckDemoStatus(void)
 {
     int         endtime;
 
+    G_CloseStateHash();
+
     if (timingdemo)
     {
         float fps;
@@ -2092,6 +2153,25 @@ boolean G_CheckDemoStatus(void)
         timingdemo = false;
         demoplayback = false;
 
+        M_BenchShutdown();
+
+        if (simdemo)
+            G_PrintSimHashes();
+
+        if (headless)
+        {
+            printf("Timed %i gametics in %i realtics (%f fps)\n",
+                   gametic, realtics, fps);
+            I_Quit();
+        }
+
+        if (zonestats)
+        {
+            Z_PrintStats();
+            P_PrintMobjStats();
+            P_PrintSightStats();
+        }
+
         I_Error("Timed %i gametics in %i realtics (%f fps)",
                 gametic, realtics, fps);
     }
@@ -55,6 +55,7 @@ void G_DeferredPlayDemo(char *demo);
 void G_LoadGame(char *name);
 
 void G_DoLoadGame(void);
+void G_UnArchiveGame(void);
 
 // Called by M_Responder.
 void G_SaveGame(int slot, char *description);
@@ -66,6 +67,8 @@ void G_BeginRecording(void);
 
 void G_PlayDemo(char *name);
 void G_TimeDemo(char *name);
+void G_SimDemo(char *name);
+void G_RestartDemo(void);
 boolean G_CheckDemoStatus(void);
 
 void G_ExitLevel(void);
@@ -81,6 +84,24 @@ void G_Ticker(void);
 boolean G_Responder(event_t *ev);
 
 void G_ScreenShot(void);
+
+// Rewinding to snapshots of the game taken as it is played.
+void G_InitRewind(void);
+void G_ClearRewind(void);
+void G_RewindTicker(void);
+void G_DoRewind(void);
+
+// Seeking through demos, by the left and right arrows.
+#define DEMOSEEKTICS    (10 * TICRATE)
+
+void G_DemoSeek(int tic);
+void G_CheckDemoSeek(void);
+
+// Hashing the playsim every tic of a demo, to find where it desyncs.
+void G_InitStateHash(void);
+void G_StateHashTicker(void);
+void G_CloseStateHash(void);
+void G_PrintSimHashes(void);
 void ToggleWideScreen(boolean toggle);
 
 extern boolean  canmodify;
@@ -90,10 +111,15 @@ extern boolean  vibrate;
 extern char     lbmname[256];
 extern char     mapnumandtitle[133];
 extern int      gamepadpress;
+extern byte     *demobuffer;
+extern byte     *demo_p;
+extern int      demotic;
 extern int      gamepadwait;
 extern int      keydown;
 extern int      markpointnum;
 extern int      quickSaveSlot;
+extern int      rewindinterval;
+extern boolean  statehash;
 extern int      st_facecount;
 extern boolean  oldweaponsowned[NUMWEAPONS];
 #endif
\ No newline at end of file
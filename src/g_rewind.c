@@ -0,0 +1,412 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "doomstat.h"
+#include "dstrings.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "m_compress.h"
+#include "m_menu.h"
+#include "p_saveg.h"
+#include "s_sound.h"
+#include "z_zone.h"
+
+//
+// Snapshots of the game are taken every rewindinterval tics while it is
+//  being played, by saving it to memory as if it were a savegame. Only
+//  the newest snapshot is kept as it is. When another is taken, the one
+//  before it is XORed with it, which leaves mostly zeros, and compressed.
+//  Each snapshot can then be rebuilt from the one after it, and the
+//  oldest dropped when they are all used without affecting the rest.
+//
+#define REWINDSNAPSHOTS 128
+
+typedef struct
+{
+    byte        *data;          // compressed, or NULL if the newest
+    int         compressedlength;
+    int         length;
+    int         tic;            // gametic when taken
+} snapshot_t;
+
+static snapshot_t       snapshots[REWINDSNAPSHOTS];
+static int              numsnapshots;
+static int              newestsnapshot;
+static byte             *newestdata;
+
+int                     rewindinterval;
+
+//
+// Demos being played back can be sought through. Once a demo has been
+//  sought through, a keyframe is taken every DEMOSEEKTICS tics of it,
+//  compressed on its own, along with where the demo is up to. To seek,
+//  the last keyframe before the tic sought is loaded, and the demo is
+//  played from there as fast as it can be, which also takes the keyframes
+//  after it that haven't been taken yet. None are taken for demos being
+//  timed, as they would stall it.
+//
+#define MAXKEYFRAMES    1024
+
+typedef struct
+{
+    byte        *data;
+    int         compressedlength;
+    int         length;
+    int         tic;            // demotic when taken
+    int         demooffset;     // demo_p - demobuffer when taken
+} keyframe_t;
+
+static keyframe_t       keyframes[MAXKEYFRAMES];
+static int              numkeyframes;
+static boolean          keyframing;
+static int              demoseektic = -1;
+
+//
+// G_InitRewind
+//
+void G_InitRewind(void)
+{
+    //!
+    // @arg [<tics>]
+    // @category game
+    //
+    // Take a snapshot of the game every <tics> (35 if not given) while
+    // playing, so it can be rewound with the rewind key (backspace).
+    //
+    int p = M_CheckParm("-rewind");
+
+    if (p)
+    {
+        rewindinterval = TICRATE;
+        if (p < myargc - 1 && myargv[p + 1][0] != '-')
+            rewindinterval = MAX(1, atoi(myargv[p + 1]));
+    }
+
+    //!
+    // @arg <seconds>
+    // @category demo
+    //
+    // Skip the first <seconds> of the demo played back.
+    //
+
+    p = M_CheckParmWithArgs("-skipsec", 1);
+
+    if (p)
+        demoseektic = MAX(0, atoi(myargv[p + 1])) * TICRATE;
+}
+
+// XOR one snapshot with another, over the length of the shorter one.
+static void G_XORSnapshot(byte *dest, int destlength, const byte *source, int length)
+{
+    int i;
+    int n = MIN(destlength, length);
+
+    for (i = 0; i < n; i++)
+        dest[i] ^= source[i];
+}
+
+//
+// G_ClearRewind
+// Drop all the snapshots and keyframes, when a new game is started or
+//  loaded, or a demo played back.
+//
+void G_ClearRewind(void)
+{
+    int i;
+
+    for (i = 0; i < numkeyframes; i++)
+        Z_Free(keyframes[i].data);
+    numkeyframes = 0;
+    keyframing = false;
+
+    for (i = 0; i < REWINDSNAPSHOTS; i++)
+        if (snapshots[i].data)
+        {
+            Z_Free(snapshots[i].data);
+            snapshots[i].data = NULL;
+        }
+    if (newestdata)
+    {
+        Z_Free(newestdata);
+        newestdata = NULL;
+    }
+    numsnapshots = 0;
+}
+
+// Save the game to memory, as if it were a savegame.
+static byte *G_SaveSnapshot(int *length)
+{
+    byte        *buffer;
+    size_t      size;
+    byte        *data;
+
+    save_stream = mem_fopen_write();
+    P_WriteSaveGameHeader("");
+    P_ArchivePlayers();
+    P_ArchiveWorld();
+    P_ArchiveThinkers();
+    P_ArchiveSpecials();
+    P_ArchiveMisc();
+    P_WriteSaveGameEOF();
+
+    mem_get_buf(save_stream, (void **)&buffer, &size);
+    data = (byte *)Z_Malloc(size, PU_STATIC, NULL);
+    memcpy(data, buffer, size);
+    mem_fclose(save_stream);
+    save_stream = NULL;
+
+    *length = size;
+    return data;
+}
+
+// Load the game from a snapshot. The snapshot is freed once it is loaded.
+static void G_LoadSnapshot(byte *data, int length)
+{
+    P_OpenSaveGameBuffer(data, length);
+    G_UnArchiveGame();
+}
+
+static void G_TakeSnapshot(void)
+{
+    int         length;
+    byte        *data = G_SaveSnapshot(&length);
+    snapshot_t  *snapshot;
+
+    if (numsnapshots)
+    {
+        byte    *compressed;
+
+        // replace the newest snapshot with the difference from this one
+        snapshot = &snapshots[newestsnapshot];
+        G_XORSnapshot(newestdata, snapshot->length, data, length);
+        compressed = (byte *)Z_Malloc(COMPRESSBLOCKSBOUND(snapshot->length), PU_STATIC, NULL);
+        snapshot->compressedlength = M_CompressBlocks(newestdata, snapshot->length, compressed);
+        snapshot->data = (byte *)Z_Malloc(snapshot->compressedlength, PU_STATIC, NULL);
+        memcpy(snapshot->data, compressed, snapshot->compressedlength);
+        Z_Free(compressed);
+        Z_Free(newestdata);
+
+        // drop the oldest if they are all used
+        if (numsnapshots == REWINDSNAPSHOTS)
+        {
+            snapshot = &snapshots[(newestsnapshot + 1) % REWINDSNAPSHOTS];
+            Z_Free(snapshot->data);
+            snapshot->data = NULL;
+            numsnapshots--;
+        }
+        newestsnapshot = (newestsnapshot + 1) % REWINDSNAPSHOTS;
+    }
+
+    snapshot = &snapshots[newestsnapshot];
+    snapshot->length = length;
+    snapshot->tic = gametic;
+    newestdata = data;
+    numsnapshots++;
+}
+
+// Rebuild the snapshot before the newest, and drop the newest.
+static void G_DropNewestSnapshot(void)
+{
+    int         previous = (newestsnapshot + REWINDSNAPSHOTS - 1) % REWINDSNAPSHOTS;
+    snapshot_t  *snapshot = &snapshots[previous];
+    byte        *data = (byte *)Z_Malloc(snapshot->length, PU_STATIC, NULL);
+
+    if (!M_DecompressBlocks(snapshot->data, snapshot->compressedlength, data, snapshot->length))
+        I_Error("G_DropNewestSnapshot: Snapshot is corrupt");
+    G_XORSnapshot(data, snapshot->length, newestdata, snapshots[newestsnapshot].length);
+
+    Z_Free(snapshot->data);
+    snapshot->data = NULL;
+    Z_Free(newestdata);
+    newestdata = data;
+    newestsnapshot = previous;
+    numsnapshots--;
+}
+
+static void G_TakeKeyframe(void)
+{
+    keyframe_t  *keyframe = &keyframes[numkeyframes++];
+    byte        *data = G_SaveSnapshot(&keyframe->length);
+    byte        *compressed = (byte *)Z_Malloc(COMPRESSBLOCKSBOUND(keyframe->length),
+                                               PU_STATIC, NULL);
+
+    keyframe->compressedlength = M_CompressBlocks(data, keyframe->length, compressed);
+    keyframe->data = (byte *)Z_Malloc(keyframe->compressedlength, PU_STATIC, NULL);
+    memcpy(keyframe->data, compressed, keyframe->compressedlength);
+    keyframe->tic = demotic;
+    keyframe->demooffset = demo_p - demobuffer;
+    Z_Free(compressed);
+    Z_Free(data);
+}
+
+static void G_LoadKeyframe(keyframe_t *keyframe)
+{
+    byte        *data = (byte *)Z_Malloc(keyframe->length, PU_STATIC, NULL);
+
+    if (!M_DecompressBlocks(keyframe->data, keyframe->compressedlength, data, keyframe->length))
+        I_Error("G_LoadKeyframe: Keyframe is corrupt");
+
+    // don't spend a lot of time in loadlevel
+    precache = false;
+    demoloading = true;
+    G_LoadSnapshot(data, keyframe->length);
+    demoloading = false;
+    precache = true;
+
+    usergame = false;
+    demoplayback = true;
+    demo_p = demobuffer + keyframe->demooffset;
+    demotic = keyframe->tic;
+
+    // it was taken at the end of a tic, before gametic was advanced
+    levelstarttic--;
+}
+
+//
+// G_DemoSeek
+// Seek to a tic of the demo being played back. This is done before the
+//  next tic is run.
+//
+void G_DemoSeek(int tic)
+{
+    demoseektic = MAX(0, tic);
+    keyframing = !timingdemo && !headless;
+}
+
+static void G_DoDemoSeek(void)
+{
+    int         tic = demoseektic;
+    int         i = numkeyframes - 1;
+    boolean     oldnosfx = nosfx;
+
+    demoseektic = -1;
+    paused = false;
+
+    // go back to the last keyframe before the tic, unless already past it
+    while (i >= 0 && keyframes[i].tic > tic)
+        i--;
+    if (i >= 0 && (tic < demotic || keyframes[i].tic > demotic))
+        G_LoadKeyframe(&keyframes[i]);
+    else if (tic < demotic)
+        G_RestartDemo();
+
+    // gametic isn't advanced for the tics played here, so levelstarttic
+    //  is moved back after each instead to keep the time into the level
+    //  the same
+    nosfx = true;
+    while (demoplayback && demotic < tic)
+    {
+        G_Ticker();
+        levelstarttic--;
+    }
+    nosfx = oldnosfx;
+    S_StopSounds();
+}
+
+//
+// G_CheckDemoSeek
+// Called by TryRunTics before each tic, so the seek isn't done from
+//  inside G_Ticker.
+//
+void G_CheckDemoSeek(void)
+{
+    if (demoseektic < 0 || !demoplayback)
+        return;
+
+    // not while writing a hash of every tic
+    if (statehash)
+        demoseektic = -1;
+    else
+        G_DoDemoSeek();
+}
+
+//
+// G_RewindTicker
+// Called at the end of every tic.
+//
+void G_RewindTicker(void)
+{
+    if (demoplayback)
+    {
+        if (keyframing && gamestate == GS_LEVEL && gameaction == ga_nothing && !paused
+            && numkeyframes < MAXKEYFRAMES
+            && demotic >= (numkeyframes ? keyframes[numkeyframes - 1].tic + DEMOSEEKTICS : 0))
+            G_TakeKeyframe();
+        return;
+    }
+
+    if (!rewindinterval || demorecording || netgame || gamestate != GS_LEVEL)
+        return;
+
+    // not if P_Ticker didn't run
+    if (paused || (menuactive && players[consoleplayer].viewz != 1))
+        return;
+
+    if (leveltime % rewindinterval || players[consoleplayer].playerstate != PST_LIVE)
+        return;
+
+    G_TakeSnapshot();
+}
+
+//
+// G_DoRewind
+// Go back to the newest snapshot taken at least a second ago, so
+//  rewinding again goes further back.
+//
+void G_DoRewind(void)
+{
+    static char message[80];
+    snapshot_t  *snapshot;
+    byte        *data;
+    int         seconds;
+
+    gameaction = ga_nothing;
+
+    if (!numsnapshots)
+        return;
+
+    while (numsnapshots > 1 && gametic - snapshots[newestsnapshot].tic < TICRATE)
+        G_DropNewestSnapshot();
+
+    snapshot = &snapshots[newestsnapshot];
+    seconds = (gametic - snapshot->tic) / TICRATE;
+    snapshot->tic = gametic;
+
+    // the savegame is freed once it is loaded, so load a copy
+    data = (byte *)Z_Malloc(snapshot->length, PU_STATIC, NULL);
+    memcpy(data, newestdata, snapshot->length);
+    G_LoadSnapshot(data, snapshot->length);
+
+    sprintf(message, GREWOUND, seconds, (seconds == 1 ? "" : "s"));
+    players[consoleplayer].message = message;
+}
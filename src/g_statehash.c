@@ -0,0 +1,458 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "doomstat.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "md5.h"
+#include "p_local.h"
+#include "r_state.h"
+
+//
+// While a demo is recorded or played back, the playsim can be hashed
+//  every tic and written to a file. The things, sectors, lines, players
+//  and random number indexes are split into fields, each hashed with MD5
+//  on its own, and the first 4 bytes of each kept. Playing the demo back
+//  again compares against that file, and stops at the first tic that
+//  doesn't match, naming the fields that don't. Each tic is found in the
+//  file by its number, so the demo can be sought through while comparing.
+// -simdemo uses the same fields, keeping a hash of them all for each tic
+//  to print when the demo ends.
+//
+#define STATEHASHID         "DRSTATEHASH"
+#define STATEHASHVERSION    1
+#define STATEHASHHEADERSIZE (sizeof(STATEHASHID) + 2)
+#define STATEHASHTICSIZE    (4 * (1 + NUMSTATEFIELDS))
+
+typedef enum
+{
+    sh_game,
+    sh_random,
+    sh_players,
+    sh_mobjcount,
+    sh_mobjpositions,
+    sh_mobjmomentum,
+    sh_mobjstates,
+    sh_mobjflags,
+    sh_mobjhealth,
+    sh_mobjmovement,
+    sh_sectorheights,
+    sh_sectorspecials,
+    sh_lines,
+    sh_sides,
+    NUMSTATEFIELDS
+} statefield_t;
+
+static char *statefieldnames[NUMSTATEFIELDS] =
+{
+    "game state and level time",
+    "random number indexes",
+    "players",
+    "number of things",
+    "positions of things",
+    "momentum of things",
+    "states of things",
+    "flags of things",
+    "health of things",
+    "targets and movement of things",
+    "sector heights",
+    "sector lights and specials",
+    "line specials and flags",
+    "side textures and offsets"
+};
+
+boolean                 statehash;      // writing, so the demo can't be sought through
+
+static FILE             *statehashfile;
+static char             *statehashfilename;
+static boolean          comparingstatehash;
+static int              statehashtics;
+
+static unsigned int     *simhashes;     // hash of each tic of -simdemo
+static int              numsimhashes;
+static int              maxsimhashes;
+
+static void G_WriteStateHash32(unsigned int value)
+{
+    fputc(value & 0xFF, statehashfile);
+    fputc((value >> 8) & 0xFF, statehashfile);
+    fputc((value >> 16) & 0xFF, statehashfile);
+    fputc((value >> 24) & 0xFF, statehashfile);
+}
+
+static boolean G_ReadStateHash32(unsigned int *value)
+{
+    byte        buffer[4];
+
+    if (fread(buffer, 1, 4, statehashfile) != 4)
+        return false;
+    *value = buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((unsigned int)buffer[3] << 24);
+    return true;
+}
+
+//
+// G_InitStateHash
+//
+void G_InitStateHash(void)
+{
+    char        id[sizeof(STATEHASHID)];
+    int         p;
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // Write a hash of the playsim for every tic of the demo being
+    // recorded or played back to <file>.
+    //
+    p = M_CheckParmWithArgs("-statehash", 1);
+
+    if (p)
+    {
+        statehashfilename = myargv[p + 1];
+        statehashfile = fopen(statehashfilename, "wb");
+        if (!statehashfile)
+            I_Error("G_InitStateHash: Couldn't write %s", statehashfilename);
+        fwrite(STATEHASHID, 1, sizeof(STATEHASHID), statehashfile);
+        fputc(STATEHASHVERSION, statehashfile);
+        fputc(NUMSTATEFIELDS, statehashfile);
+        statehash = true;
+        return;
+    }
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // Compare the playsim for every tic of the demo being played back
+    // with the hashes written to <file> by -statehash, and stop at the
+    // first tic and fields that are different. Tics are compared across
+    // seeks too, so -playdemo <demo> -skipsec <seconds> -comparestatehash
+    // <file> checks that seeking plays the demo back the same.
+    //
+    p = M_CheckParmWithArgs("-comparestatehash", 1);
+
+    if (p)
+    {
+        statehashfilename = myargv[p + 1];
+        statehashfile = fopen(statehashfilename, "rb");
+        if (!statehashfile)
+            I_Error("G_InitStateHash: Couldn't read %s", statehashfilename);
+        if (fread(id, 1, sizeof(id), statehashfile) != sizeof(id)
+            || memcmp(id, STATEHASHID, sizeof(id))
+            || fgetc(statehashfile) != STATEHASHVERSION
+            || fgetc(statehashfile) != NUMSTATEFIELDS)
+            I_Error("G_InitStateHash: %s isn't a state hash file", statehashfilename);
+        comparingstatehash = true;
+    }
+}
+
+static void G_HashMobj(md5_context_t *md5, mobj_t *mo)
+{
+    mobj_t      *target = mo->target;
+
+    MD5_UpdateInt32(&md5[sh_mobjpositions], mo->x);
+    MD5_UpdateInt32(&md5[sh_mobjpositions], mo->y);
+    MD5_UpdateInt32(&md5[sh_mobjpositions], mo->z);
+    MD5_UpdateInt32(&md5[sh_mobjpositions], mo->angle);
+    MD5_UpdateInt32(&md5[sh_mobjpositions], mo->floorz);
+    MD5_UpdateInt32(&md5[sh_mobjpositions], mo->ceilingz);
+
+    MD5_UpdateInt32(&md5[sh_mobjmomentum], mo->momx);
+    MD5_UpdateInt32(&md5[sh_mobjmomentum], mo->momy);
+    MD5_UpdateInt32(&md5[sh_mobjmomentum], mo->momz);
+
+    MD5_UpdateInt32(&md5[sh_mobjstates], mo->type);
+    MD5_UpdateInt32(&md5[sh_mobjstates], mo->state - states);
+    MD5_UpdateInt32(&md5[sh_mobjstates], mo->tics);
+    MD5_UpdateInt32(&md5[sh_mobjstates], mo->sprite);
+    MD5_UpdateInt32(&md5[sh_mobjstates], mo->frame);
+
+    MD5_UpdateInt32(&md5[sh_mobjflags], mo->flags);
+
+    MD5_UpdateInt32(&md5[sh_mobjhealth], mo->health);
+
+    // targets are told apart by their type and position
+    MD5_UpdateInt32(&md5[sh_mobjmovement], target ? target->type : -1);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], target ? target->x : 0);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], target ? target->y : 0);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], mo->tracer ? mo->tracer->type : -1);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], mo->movedir);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], mo->movecount);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], mo->reactiontime);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], mo->threshold);
+    MD5_UpdateInt32(&md5[sh_mobjmovement], mo->lastlook);
+}
+
+static void G_HashPlayer(md5_context_t *md5, player_t *player)
+{
+    int i;
+
+    MD5_UpdateInt32(md5, player->playerstate);
+    MD5_UpdateInt32(md5, player->viewz);
+    MD5_UpdateInt32(md5, player->viewheight);
+    MD5_UpdateInt32(md5, player->deltaviewheight);
+    MD5_UpdateInt32(md5, player->bob);
+    MD5_UpdateInt32(md5, player->health);
+    MD5_UpdateInt32(md5, player->armorpoints);
+    MD5_UpdateInt32(md5, player->armortype);
+    for (i = 0; i < NUMPOWERS; i++)
+        MD5_UpdateInt32(md5, player->powers[i]);
+    for (i = 0; i < NUMCARDS; i++)
+        MD5_UpdateInt32(md5, player->cards[i]);
+    MD5_UpdateInt32(md5, player->backpack);
+    for (i = 0; i < MAXPLAYERS; i++)
+        MD5_UpdateInt32(md5, player->frags[i]);
+    MD5_UpdateInt32(md5, player->readyweapon);
+    MD5_UpdateInt32(md5, player->pendingweapon);
+    for (i = 0; i < NUMWEAPONS; i++)
+        MD5_UpdateInt32(md5, player->weaponowned[i]);
+    for (i = 0; i < NUMAMMO; i++)
+    {
+        MD5_UpdateInt32(md5, player->ammo[i]);
+        MD5_UpdateInt32(md5, player->maxammo[i]);
+    }
+    MD5_UpdateInt32(md5, player->attackdown);
+    MD5_UpdateInt32(md5, player->usedown);
+    MD5_UpdateInt32(md5, player->cheats);
+    MD5_UpdateInt32(md5, player->refire);
+    MD5_UpdateInt32(md5, player->killcount);
+    MD5_UpdateInt32(md5, player->itemcount);
+    MD5_UpdateInt32(md5, player->secretcount);
+    MD5_UpdateInt32(md5, player->damagecount);
+    MD5_UpdateInt32(md5, player->bonuscount);
+    MD5_UpdateInt32(md5, player->extralight);
+    MD5_UpdateInt32(md5, player->fixedcolormap);
+    for (i = 0; i < NUMPSPRITES; i++)
+    {
+        pspdef_t        *psp = &player->psprites[i];
+
+        MD5_UpdateInt32(md5, psp->state ? psp->state - states : -1);
+        MD5_UpdateInt32(md5, psp->tics);
+        MD5_UpdateInt32(md5, psp->sx);
+        MD5_UpdateInt32(md5, psp->sy);
+    }
+}
+
+// Finish an MD5, keeping its first 4 bytes.
+static unsigned int G_FinalHash32(md5_context_t *md5)
+{
+    md5_digest_t        digest;
+
+    MD5_Final(digest, md5);
+    return (digest[0] | (digest[1] << 8) | (digest[2] << 16)
+            | ((unsigned int)digest[3] << 24));
+}
+
+// Hash each field of the playsim, keeping the first 4 bytes of each MD5.
+static void G_HashState(unsigned int *hashes)
+{
+    md5_context_t       md5[NUMSTATEFIELDS];
+    int                 nummobjs = 0;
+    int                 i;
+
+    for (i = 0; i < NUMSTATEFIELDS; i++)
+        MD5_Init(&md5[i]);
+
+    MD5_UpdateInt32(&md5[sh_game], gamestate);
+    MD5_UpdateInt32(&md5[sh_game], gameepisode);
+    MD5_UpdateInt32(&md5[sh_game], gamemap);
+    MD5_UpdateInt32(&md5[sh_game], leveltime);
+
+    MD5_UpdateInt32(&md5[sh_random], rndindex);
+    MD5_UpdateInt32(&md5[sh_random], prndindex);
+
+    for (i = 0; i < MAXPLAYERS; i++)
+        if (playeringame[i])
+            G_HashPlayer(&md5[sh_players], &players[i]);
+
+    if (gamestate == GS_LEVEL)
+    {
+        thinker_t       *th;
+
+        // in the order they think
+        for (th = thinkercap.next; th != &thinkercap; th = th->next)
+            if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+            {
+                G_HashMobj(md5, (mobj_t *)th);
+                nummobjs++;
+            }
+
+        for (i = 0; i < numsectors; i++)
+        {
+            sector_t    *sector = &sectors[i];
+
+            MD5_UpdateInt32(&md5[sh_sectorheights], sector->floorheight);
+            MD5_UpdateInt32(&md5[sh_sectorheights], sector->ceilingheight);
+            MD5_UpdateInt32(&md5[sh_sectorspecials], sector->lightlevel);
+            MD5_UpdateInt32(&md5[sh_sectorspecials], sector->special);
+            MD5_UpdateInt32(&md5[sh_sectorspecials], sector->tag);
+            MD5_UpdateInt32(&md5[sh_sectorspecials], sector->floorpic);
+            MD5_UpdateInt32(&md5[sh_sectorspecials], sector->ceilingpic);
+        }
+
+        for (i = 0; i < numlines; i++)
+        {
+            MD5_UpdateInt32(&md5[sh_lines], lines[i].special);
+            MD5_UpdateInt32(&md5[sh_lines], lines[i].flags);
+        }
+
+        for (i = 0; i < numsides; i++)
+        {
+            side_t      *side = &sides[i];
+
+            MD5_UpdateInt32(&md5[sh_sides], side->toptexture);
+            MD5_UpdateInt32(&md5[sh_sides], side->midtexture);
+            MD5_UpdateInt32(&md5[sh_sides], side->bottomtexture);
+            MD5_UpdateInt32(&md5[sh_sides], side->textureoffset);
+            MD5_UpdateInt32(&md5[sh_sides], side->rowoffset);
+        }
+    }
+    MD5_UpdateInt32(&md5[sh_mobjcount], nummobjs);
+
+    for (i = 0; i < NUMSTATEFIELDS; i++)
+        hashes[i] = G_FinalHash32(&md5[i]);
+}
+
+// Keep one hash of every field for each tic of -simdemo.
+static void G_AddSimHash(unsigned int *hashes)
+{
+    md5_context_t       md5;
+    int                 i;
+
+    if (numsimhashes == maxsimhashes)
+    {
+        maxsimhashes = (maxsimhashes ? maxsimhashes * 2 : 4096);
+        simhashes = (unsigned int *)realloc(simhashes, maxsimhashes * sizeof(*simhashes));
+        if (!simhashes)
+            I_Error("G_AddSimHash: Out of memory");
+    }
+
+    MD5_Init(&md5);
+    for (i = 0; i < NUMSTATEFIELDS; i++)
+        MD5_UpdateInt32(&md5, hashes[i]);
+    simhashes[numsimhashes++] = G_FinalHash32(&md5);
+}
+
+//
+// G_PrintSimHashes
+// Print the hash of each tic of -simdemo, then a hash of them all.
+//
+void G_PrintSimHashes(void)
+{
+    md5_context_t       md5;
+    int                 i;
+
+    MD5_Init(&md5);
+    for (i = 0; i < numsimhashes; i++)
+    {
+        printf("%i %08x\n", i, simhashes[i]);
+        MD5_UpdateInt32(&md5, simhashes[i]);
+    }
+    printf("State hash of %i tics: %08x\n", numsimhashes, G_FinalHash32(&md5));
+}
+
+//
+// G_StateHashTicker
+// Called at the end of every tic while a demo is recorded or played back.
+//
+void G_StateHashTicker(void)
+{
+    unsigned int        hashes[NUMSTATEFIELDS];
+    int                 i;
+
+    if (!statehashfile && !(simdemo && demoplayback))
+        return;
+
+    G_HashState(hashes);
+
+    if (simdemo && demoplayback)
+        G_AddSimHash(hashes);
+
+    if (!statehashfile)
+        return;
+
+    statehashtics++;
+
+    if (comparingstatehash)
+    {
+        char            fields[512];
+        unsigned int    tic;
+        unsigned int    hash;
+
+        if (fseek(statehashfile, STATEHASHHEADERSIZE + (demotic - 1) * STATEHASHTICSIZE, SEEK_SET)
+            || !G_ReadStateHash32(&tic))
+            I_Error("%s ends before tic %i of the demo", statehashfilename, demotic);
+
+        fields[0] = '\0';
+        for (i = 0; i < NUMSTATEFIELDS; i++)
+            if (!G_ReadStateHash32(&hash) || hash != hashes[i])
+            {
+                if (fields[0])
+                    strcat(fields, ", ");
+                strcat(fields, statefieldnames[i]);
+            }
+
+        if ((int)tic != demotic)
+            I_Error("%s is at tic %i, not tic %i", statehashfilename, tic, demotic);
+        if (fields[0])
+            I_Error("The demo differs from %s at tic %i, in the %s",
+                    statehashfilename, demotic, fields);
+    }
+    else
+    {
+        G_WriteStateHash32(demotic);
+        for (i = 0; i < NUMSTATEFIELDS; i++)
+            G_WriteStateHash32(hashes[i]);
+    }
+}
+
+//
+// G_CloseStateHash
+// Called when the demo ends.
+//
+void G_CloseStateHash(void)
+{
+    if (!statehashfile)
+        return;
+
+    if (comparingstatehash)
+    {
+        if (fgetc(statehashfile) != EOF)
+            I_Error("The demo ends at tic %i, before %s does",
+                    demotic, statehashfilename);
+        printf("The demo matches %s for the %i tics compared\n", statehashfilename, statehashtics);
+    }
+
+    fclose(statehashfile);
+    statehashfile = NULL;
+}
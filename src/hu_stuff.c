@@ -340,6 +340,19 @@ void HU_Ticker(void)
         HUlib_addMessageToSText(&w_message, 0, buffer);
         message_on = true;
     }
+    else if (showrenderstats)
+    {
+        // display and constantly update renderer statistics for -RENDERSTATS
+        char buffer[80];
+
+        sprintf(buffer, "DS %i/%i  VS %i/%i  OP %i/%i  VP %i/%i",
+                renderstats[rs_drawsegs], renderpeaks[rs_drawsegs],
+                renderstats[rs_vissprites], renderpeaks[rs_vissprites],
+                renderstats[rs_openings], renderpeaks[rs_openings],
+                renderstats[rs_visplanes], renderpeaks[rs_visplanes]);
+        HUlib_addMessageToSText(&w_message, 0, buffer);
+        message_on = true;
+    }
     else if (devparm)
     {
         // [BH] display and constantly update FPS for -DEVPARM
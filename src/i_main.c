@@ -79,6 +79,18 @@ static void LockCPUAffinity(void)
     }
 }
 
+// Undo LockCPUAffinity, so that the renderer's draw threads can run on
+// all cores. Called by R_InitDrawThreads when more than one is wanted.
+
+void UnlockCPUAffinity(void)
+{
+    DWORD_PTR processmask;
+    DWORD_PTR systemmask;
+
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processmask, &systemmask))
+        SetProcessAffinityMask(GetCurrentProcess(), systemmask);
+}
+
 extern int fullscreen;
 extern boolean window_focused;
 HHOOK g_hKeyboardHook;
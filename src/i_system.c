@@ -43,6 +43,8 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "i_gamepad.h"
 #include "i_timer.h"
 #include "i_video.h"
+#include "p_local.h"
+#include "p_saveg.h"
 #include "s_sound.h"
 
 #include "d_net.h"
@@ -148,6 +150,7 @@ void I_Quit(void)
     D_QuitNetGame();
     if (demorecording)
         G_CheckDemoStatus();
+    P_WaitForSaveGame();
     S_Shutdown();
 
     I_SaveWindowPosition();
@@ -155,12 +158,20 @@ void I_Quit(void)
     if (returntowidescreen)
         widescreen = true;
 
-    M_SaveDefaults();
+    if (!headless)
+        M_SaveDefaults();
 
     I_ShutdownGraphics();
 
     I_ShutdownGamepad();
 
+    if (zonestats)
+    {
+        Z_PrintStats();
+        P_PrintMobjStats();
+        P_PrintSightStats();
+    }
+
     exit(0);
 }
 
@@ -220,6 +231,9 @@ void I_Error(char *error, ...)
     vsnprintf(msgbuf, sizeof(msgbuf) - 1, error, argptr);
     va_end(argptr);
 
+    if (headless)
+        exit(-1);
+
     MultiByteToWideChar(CP_ACP, 0,
                         msgbuf, strlen(msgbuf) + 1,
                         wmsgbuf, sizeof(wmsgbuf));
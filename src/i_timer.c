@@ -26,6 +26,9 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
 #include "SDL.h"
 
 #include "i_timer.h"
@@ -68,6 +71,25 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+//
+// Same as I_GetTime, but returns time in microseconds from the
+// high-resolution performance counter. Used for profiling.
+//
+
+uint64_t I_GetTimeUS(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        counter;
+
+    if (!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart * 1000000
+                      + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
@@ -26,7 +26,9 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
-#include <math.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "doomdef.h"
 #include "doomtype.h"
@@ -34,7 +36,9 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "i_video.h"
 #include "z_zone.h"
 #include "m_argv.h"
+#include "m_config.h"
 #include "m_fixed.h"
+#include "md5.h"
 
 #define ADDITIVE -1
 
@@ -59,20 +63,35 @@ static byte filter[256] = {
 #define GREENS G
 #define BLUES  B
 
+//
+// FindNearestColor
+// The palette index closest to the given color, using a weighted
+//  distance that approximates how the eye sees it. Distances are
+//  compared squared, which gives the same result without needing a
+//  sqrt per entry, and the green term (the largest) is checked first
+//  to skip most entries early.
+//
 int FindNearestColor(byte *palette, int red, int green, int blue)
 {
-    double best_difference = LONG_MAX;
+    long best_difference = LONG_MAX;
     int best_color = 0;
     int i;
 
-    for (i = 0; i < 256; ++i)
+    for (i = 0; i < 256; ++i, palette += 3)
     {
-        long rmean = ((long)red + *palette) >> 1;
-        long r = (long)red - *palette++;
-        long g = (long)green - *palette++;
-        long b = (long)blue - *palette++;
-        double difference = sqrt((double)((((512 + rmean) * r * r) >> 8) +
-                            4 * g * g + (((767 - rmean) * b * b) >> 8)));
+        long g = (long)green - palette[1];
+        long difference = 4 * g * g;
+
+        if (difference >= best_difference)
+            continue;
+
+        {
+            long rmean = ((long)red + palette[0]) >> 1;
+            long r = (long)red - palette[0];
+            long b = (long)blue - palette[2];
+
+            difference += (((512 + rmean) * r * r) >> 8) + (((767 - rmean) * b * b) >> 8);
+        }
 
         if (!difference)
             return i;
@@ -85,12 +104,10 @@ int FindNearestColor(byte *palette, int red, int green, int blue)
     return best_color;
 }
 
-static byte *GenerateTintTable(byte *palette, int percent, int colors)
+static void GenerateTintTable(byte *result, byte *palette, int percent, int colors)
 {
-    byte *result;
     int foreground, background;
 
-    result = (byte *)Z_Malloc(65536, PU_STATIC, NULL);
     for (foreground = 0; foreground < 256; ++foreground)
     {
         if ((filter[foreground] & colors) || colors == ALL)
@@ -128,7 +145,6 @@ static byte *GenerateTintTable(byte *palette, int percent, int colors)
         *(result + (77 << 8) + 109) = *(result + (109 << 8) + 77) = 77;
         *(result + (78 << 8) + 109) = *(result + (109 << 8) + 78) = 109;
     }
-    return result;
 }
 
 byte *tinttab;
@@ -149,23 +165,126 @@ byte *tinttabredwhite50;
 byte *tinttabgreen50;
 byte *tinttabblue50;
 
+//
+// The tint tables are cached in the config directory, and only generated
+//  again if the palette (or the way they are generated) changes.
+//
+#define TINTTABCACHE    "tinttabs.dat"
+#define TINTTABMAGIC    "DRTINT"
+#define TINTTABVERSION  1
+#define NUMTINTTABS     14
+
+typedef struct
+{
+    char        magic[6];
+    short       version;
+    byte        hash[16];
+} tinttabheader_t;
+
+static void HashTintTables(byte *palette, byte *hash)
+{
+    md5_context_t       md5;
+
+    MD5_Init(&md5);
+    MD5_Update(&md5, palette, 256 * 3);
+    MD5_Update(&md5, filter, sizeof(filter));
+    MD5_Final(hash, &md5);
+}
+
+static boolean LoadTintTables(char *filename, byte *hash, byte *tables)
+{
+    FILE                *handle = fopen(filename, "rb");
+    tinttabheader_t     header;
+    boolean             result;
+
+    if (!handle)
+        return false;
+
+    result = (fread(&header, sizeof(header), 1, handle) == 1
+              && !memcmp(header.magic, TINTTABMAGIC, sizeof(header.magic))
+              && header.version == TINTTABVERSION
+              && !memcmp(header.hash, hash, sizeof(header.hash))
+              && fread(tables, 65536, NUMTINTTABS, handle) == NUMTINTTABS);
+    fclose(handle);
+    return result;
+}
+
+static void SaveTintTables(char *filename, byte *hash, byte *tables)
+{
+    FILE                *handle = fopen(filename, "wb");
+    tinttabheader_t     header;
+    boolean             result;
+
+    // can't write the file, but don't complain
+    if (!handle)
+        return;
+
+    memcpy(header.magic, TINTTABMAGIC, sizeof(header.magic));
+    header.version = TINTTABVERSION;
+    memcpy(header.hash, hash, sizeof(header.hash));
+
+    result = (fwrite(&header, sizeof(header), 1, handle) == 1
+              && fwrite(tables, 65536, NUMTINTTABS, handle) == NUMTINTTABS);
+    fclose(handle);
+
+    // don't leave a partial file behind
+    if (!result)
+        remove(filename);
+}
+
 void I_InitTintTables(byte *palette)
 {
-    tinttab = GenerateTintTable(palette, ADDITIVE, ALL);
-
-    tinttab33 = GenerateTintTable(palette, 33, ALL);
-    tinttab50 = GenerateTintTable(palette, 50, ALL);
-    tinttab60 = GenerateTintTable(palette, 60, ALL);
-    tinttab75 = GenerateTintTable(palette, 75, ALL);
-    tinttab80 = GenerateTintTable(palette, 80, ALL);
-
-    tinttabred = GenerateTintTable(palette, ADDITIVE, REDS);
-    tinttabredwhite = GenerateTintTable(palette, ADDITIVE, REDS | WHITES);
-    tinttabgreen = GenerateTintTable(palette, ADDITIVE, GREENS);
-    tinttabblue = GenerateTintTable(palette, ADDITIVE, BLUES);
-
-    tinttabred50 = GenerateTintTable(palette, 50, REDS);
-    tinttabredwhite50 = GenerateTintTable(palette, 50, REDS | WHITES);
-    tinttabgreen50 = GenerateTintTable(palette, 50, GREENS);
-    tinttabblue50 = GenerateTintTable(palette, 50, BLUES);
+    byte        *tables = (byte *)Z_Malloc(NUMTINTTABS * 65536, PU_STATIC, NULL);
+    byte        hash[16];
+    char        *filename = (char *)Z_Malloc(strlen(configdir) + strlen(TINTTABCACHE) + 1,
+                                             PU_STATIC, NULL);
+    int         i = 0;
+
+    tinttab = tables;
+
+    tinttab33 = tables + 65536 * ++i;
+    tinttab50 = tables + 65536 * ++i;
+    tinttab60 = tables + 65536 * ++i;
+    tinttab75 = tables + 65536 * ++i;
+    tinttab80 = tables + 65536 * ++i;
+
+    tinttabred = tables + 65536 * ++i;
+    tinttabredwhite = tables + 65536 * ++i;
+    tinttabgreen = tables + 65536 * ++i;
+    tinttabblue = tables + 65536 * ++i;
+
+    tinttabred50 = tables + 65536 * ++i;
+    tinttabredwhite50 = tables + 65536 * ++i;
+    tinttabgreen50 = tables + 65536 * ++i;
+    tinttabblue50 = tables + 65536 * ++i;
+
+    HashTintTables(palette, hash);
+    sprintf(filename, "%s%s", configdir, TINTTABCACHE);
+
+    if (!M_CheckParm("-nocache") && LoadTintTables(filename, hash, tables))
+    {
+        Z_Free(filename);
+        return;
+    }
+
+    GenerateTintTable(tinttab, palette, ADDITIVE, ALL);
+
+    GenerateTintTable(tinttab33, palette, 33, ALL);
+    GenerateTintTable(tinttab50, palette, 50, ALL);
+    GenerateTintTable(tinttab60, palette, 60, ALL);
+    GenerateTintTable(tinttab75, palette, 75, ALL);
+    GenerateTintTable(tinttab80, palette, 80, ALL);
+
+    GenerateTintTable(tinttabred, palette, ADDITIVE, REDS);
+    GenerateTintTable(tinttabredwhite, palette, ADDITIVE, REDS | WHITES);
+    GenerateTintTable(tinttabgreen, palette, ADDITIVE, GREENS);
+    GenerateTintTable(tinttabblue, palette, ADDITIVE, BLUES);
+
+    GenerateTintTable(tinttabred50, palette, 50, REDS);
+    GenerateTintTable(tinttabredwhite50, palette, 50, REDS | WHITES);
+    GenerateTintTable(tinttabgreen50, palette, 50, GREENS);
+    GenerateTintTable(tinttabblue50, palette, 50, BLUES);
+
+    SaveTintTables(filename, hash, tables);
+    Z_Free(filename);
 }
\ No newline at end of file
@@ -91,6 +91,10 @@ boolean screenvisible;
 
 boolean window_focused;
 
+// Run without a window (-headless)
+
+boolean headless = false;
+
 // Empty mouse cursor
 
 static SDL_Cursor *emptycursor;
@@ -442,7 +446,7 @@ boolean keystate(int key)
 
 void I_SaveWindowPosition(void)
 {
-    if (!fullscreen)
+    if (!fullscreen && !headless)
     {
         static SDL_SysWMinfo pInfo;
         RECT r;
@@ -706,6 +710,9 @@ static void I_ReadMouse(void)
 //
 void I_StartTic(void)
 {
+    if (headless)
+        return;
+
     I_GetEvent();
     I_ReadMouse();
     gamepadfunc();
@@ -757,6 +764,9 @@ SDL_Rect dest_rect;
 //
 void I_FinishUpdate(void)
 {
+    if (headless)
+        return;
+
     if (need_resize)
     {
         ApplyWindowResize(resize_h);
@@ -1137,6 +1147,20 @@ void I_InitGraphics(void)
 
     I_InitGammaTables();
 
+    screens[0] = (byte *)Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+
+    memset(screens[0], 0, SCREENWIDTH * SCREENHEIGHT);
+
+    if (headless)
+    {
+        // render into screens[0] only, never to a window
+        fullscreen = false;
+        widescreen = returntowidescreen = false;
+        screenvisible = true;
+        I_SetPalette(doompal);
+        return;
+    }
+
     sprintf(envstring, "SDL_VIDEODRIVER=%s", videodriver);
     putenv(envstring);
 
@@ -1162,10 +1186,6 @@ void I_InitGraphics(void)
     UpdateFocus();
     UpdateGrab();
 
-    screens[0] = (byte *)Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
-
-    memset(screens[0], 0, SCREENWIDTH * SCREENHEIGHT);
-
     SDL_EnableKeyRepeat(SDL_DEFAULT_REPEAT_DELAY, SDL_DEFAULT_REPEAT_INTERVAL);
 
     while (SDL_PollEvent(&dummy));
@@ -57,6 +57,7 @@ void M_QuitDOOM();
 void R_SetViewSize(int blocks);
 
 extern boolean screenvisible;
+extern boolean headless;
 
 extern float mouse_acceleration;
 extern int mouse_threshold;
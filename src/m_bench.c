@@ -0,0 +1,147 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_bench.h"
+#include "r_main.h"
+
+// Set when -benchmark is given
+
+boolean         benchmark = false;
+
+static FILE     *benchfile;
+
+static char     *stagenames[NUMBENCHSTAGES] =
+{
+    "bsp", "planes", "masked", "hud", "ticker"
+};
+
+// Time each stage was last started, and time spent in each stage
+// during the current frame and over the whole run, in microseconds
+
+static uint64_t stagestart[NUMBENCHSTAGES];
+static uint64_t stageframe[NUMBENCHSTAGES];
+static uint64_t stagetotal[NUMBENCHSTAGES];
+
+static uint64_t framestart;
+static uint64_t frametotal;
+static int      frames;
+
+//
+// M_BenchInit
+// Opens the CSV file and writes its header
+//
+void M_BenchInit(char *filename)
+{
+    int i;
+
+    if (!(benchfile = fopen(filename, "w")))
+        I_Error("M_BenchInit: Couldn't open %s", filename);
+
+    fprintf(benchfile, "frame,gametic");
+    for (i = 0; i < NUMBENCHSTAGES; i++)
+        fprintf(benchfile, ",%s", stagenames[i]);
+    fprintf(benchfile, ",total");
+    for (i = 0; i < NUMRENDERSTATS; i++)
+        fprintf(benchfile, ",%s", renderstatnames[i]);
+    fprintf(benchfile, "\n");
+
+    framestart = I_GetTimeUS();
+    benchmark = true;
+}
+
+void M_BenchStart(benchstage_t stage)
+{
+    if (benchmark)
+        stagestart[stage] = I_GetTimeUS();
+}
+
+void M_BenchStop(benchstage_t stage)
+{
+    if (benchmark)
+        stageframe[stage] += I_GetTimeUS() - stagestart[stage];
+}
+
+//
+// M_BenchEndFrame
+// Writes one row for the frame just displayed
+//
+void M_BenchEndFrame(void)
+{
+    uint64_t now;
+    uint64_t total;
+    int      i;
+
+    if (!benchmark)
+        return;
+
+    now = I_GetTimeUS();
+    total = now - framestart;
+    framestart = now;
+
+    fprintf(benchfile, "%i,%i", frames, gametic);
+    for (i = 0; i < NUMBENCHSTAGES; i++)
+    {
+        fprintf(benchfile, ",%" PRIu64, stageframe[i]);
+        stagetotal[i] += stageframe[i];
+        stageframe[i] = 0;
+    }
+    fprintf(benchfile, ",%" PRIu64, total);
+    for (i = 0; i < NUMRENDERSTATS; i++)
+        fprintf(benchfile, ",%i", renderstats[i]);
+    fprintf(benchfile, "\n");
+
+    frametotal += total;
+    frames++;
+}
+
+//
+// M_BenchShutdown
+// Closes the CSV file and prints the average time of each stage
+//
+void M_BenchShutdown(void)
+{
+    int i;
+
+    if (!benchmark)
+        return;
+
+    benchmark = false;
+    fclose(benchfile);
+
+    if (!frames)
+        return;
+
+    for (i = 0; i < NUMBENCHSTAGES; i++)
+        printf("%-8s %10.1f us/frame\n", stagenames[i], (double)stagetotal[i] / frames);
+    printf("%-8s %10.1f us/frame (%i frames)\n", "total", (double)frametotal / frames, frames);
+    for (i = 0; i < NUMRENDERSTATS; i++)
+        printf("%-10s %8i peak\n", renderstatnames[i], renderpeaks[i]);
+}
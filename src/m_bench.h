@@ -0,0 +1,57 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#ifndef __M_BENCH__
+#define __M_BENCH__
+
+#include "doomtype.h"
+
+//
+// Per-frame timing of the renderer and game stages, along with
+// the renderer's statistics, written to a CSV file while playing
+// back a -timedemo.
+//
+typedef enum
+{
+    bench_bsp,          // R_RenderBSPNode
+    bench_planes,       // R_DrawPlanes
+    bench_masked,       // R_DrawMasked
+    bench_hud,          // ST_Drawer and HU_Drawer
+    bench_ticker,       // G_Ticker
+    NUMBENCHSTAGES
+} benchstage_t;
+
+extern boolean benchmark;
+
+void M_BenchInit(char *filename);
+void M_BenchStart(benchstage_t stage);
+void M_BenchStop(benchstage_t stage);
+void M_BenchEndFrame(void);
+void M_BenchShutdown(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,276 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#include <string.h>
+#include "m_compress.h"
+#include "m_fixed.h"
+
+//
+// A small LZ77 compressor, for blocks of up to COMPRESSBLOCK bytes.
+// Each sequence is a token byte, holding how many literals follow (high
+//  nibble) and how long the match after them is (low nibble, less
+//  MINMATCH), then any more of the literal count, the literals, a two
+//  byte offset back to the match, and any more of the match length. A
+//  nibble of 15 means the count carries on in the bytes after it, each
+//  added on until one is less than 255. The last sequence has literals
+//  but no match.
+//
+#define MINMATCH        4
+#define HASHBITS        13
+
+static int M_Hash(const byte *p)
+{
+    unsigned int        value = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+
+    return ((value * 2654435761u) >> (32 - HASHBITS));
+}
+
+static byte *M_WriteCount(byte *dest, int count)
+{
+    while (count >= 255)
+    {
+        *dest++ = 255;
+        count -= 255;
+    }
+    *dest++ = count;
+    return dest;
+}
+
+static byte *M_WriteSequence(byte *dest, const byte *literals, int numliterals,
+                             int offset, int matchlength)
+{
+    byte        *token = dest++;
+
+    *token = (MIN(numliterals, 15) << 4);
+    if (numliterals >= 15)
+        dest = M_WriteCount(dest, numliterals - 15);
+    memcpy(dest, literals, numliterals);
+    dest += numliterals;
+
+    if (matchlength)
+    {
+        matchlength -= MINMATCH;
+        *token |= MIN(matchlength, 15);
+        *dest++ = offset & 0xff;
+        *dest++ = offset >> 8;
+        if (matchlength >= 15)
+            dest = M_WriteCount(dest, matchlength - 15);
+    }
+    return dest;
+}
+
+//
+// M_Compress
+// Compress length bytes (no more than COMPRESSBLOCK) from source into
+//  dest, which must have room for COMPRESSBOUND(length) bytes. Returns
+//  how many bytes were written.
+//
+int M_Compress(const byte *source, int length, byte *dest)
+{
+    int         table[1 << HASHBITS];
+    const byte  *literals = source;
+    const byte  *p = source;
+    const byte  *end = source + length;
+    byte        *start = dest;
+
+    memset(table, -1, sizeof(table));
+
+    while (p + MINMATCH <= end)
+    {
+        int     hash = M_Hash(p);
+        int     candidate = table[hash];
+
+        table[hash] = p - source;
+
+        if (candidate >= 0 && !memcmp(source + candidate, p, MINMATCH))
+        {
+            const byte  *match = source + candidate;
+            int         matchlength = MINMATCH;
+
+            while (p + matchlength < end && match[matchlength] == p[matchlength])
+                matchlength++;
+
+            dest = M_WriteSequence(dest, literals, p - literals, p - match, matchlength);
+            p += matchlength;
+            literals = p;
+        }
+        else
+            p++;
+    }
+
+    return (M_WriteSequence(dest, literals, end - literals, 0, 0) - start);
+}
+
+static boolean M_ReadCount(const byte **source, const byte *end, int *count)
+{
+    int value;
+
+    do
+    {
+        if (*source >= end)
+            return false;
+        value = *(*source)++;
+        *count += value;
+    } while (value == 255);
+    return true;
+}
+
+//
+// M_Decompress
+// Decompress length bytes from source into exactly destlength bytes in
+//  dest. Returns false if the data is corrupt.
+//
+boolean M_Decompress(const byte *source, int length, byte *dest, int destlength)
+{
+    const byte  *end = source + length;
+    byte        *start = dest;
+    byte        *destend = dest + destlength;
+
+    while (source < end)
+    {
+        int     token = *source++;
+        int     numliterals = token >> 4;
+        int     matchlength = token & 15;
+        int     offset;
+
+        if (numliterals == 15 && !M_ReadCount(&source, end, &numliterals))
+            return false;
+        if (numliterals > end - source || numliterals > destend - dest)
+            return false;
+        memcpy(dest, source, numliterals);
+        source += numliterals;
+        dest += numliterals;
+
+        // the last sequence has no match
+        if (source == end)
+            break;
+
+        if (end - source < 2)
+            return false;
+        offset = source[0] | (source[1] << 8);
+        source += 2;
+        if (matchlength == 15 && !M_ReadCount(&source, end, &matchlength))
+            return false;
+        matchlength += MINMATCH;
+
+        if (!offset || offset > dest - start || matchlength > destend - dest)
+            return false;
+
+        // may overlap itself, so copy a byte at a time
+        while (matchlength--)
+        {
+            *dest = *(dest - offset);
+            dest++;
+        }
+    }
+    return (dest == destend);
+}
+
+//
+// Any amount of data can be compressed as a series of COMPRESSBLOCKs,
+//  each a 4-byte length and the compressed block, or the block as it is
+//  if it wouldn't compress and the top bit of the length is set.
+//
+#define STOREDBLOCK     0x80000000
+
+static void M_PutLong(byte *p, unsigned int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+static unsigned int M_GetLong(const byte *p)
+{
+    return (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+}
+
+//
+// M_CompressBlocks
+// Compress length bytes from source into dest, which must have room for
+//  COMPRESSBLOCKSBOUND(length) bytes. Returns how many bytes were
+//  written.
+//
+int M_CompressBlocks(const byte *source, int length, byte *dest)
+{
+    byte        *start = dest;
+    int         position;
+
+    for (position = 0; position < length; position += COMPRESSBLOCK)
+    {
+        int     blocklength = MIN(length - position, COMPRESSBLOCK);
+        int     compressed = M_Compress(source + position, blocklength, dest + 4);
+
+        if (compressed >= blocklength)
+        {
+            memcpy(dest + 4, source + position, blocklength);
+            M_PutLong(dest, blocklength | STOREDBLOCK);
+            compressed = blocklength;
+        }
+        else
+            M_PutLong(dest, compressed);
+        dest += 4 + compressed;
+    }
+    return (dest - start);
+}
+
+//
+// M_DecompressBlocks
+// Decompress what M_CompressBlocks wrote into exactly destlength bytes in
+//  dest. Returns false if the data is corrupt.
+//
+boolean M_DecompressBlocks(const byte *source, int length, byte *dest, int destlength)
+{
+    const byte  *end = source + length;
+    int         position;
+
+    for (position = 0; position < destlength; position += COMPRESSBLOCK)
+    {
+        int             blocklength = MIN(destlength - position, COMPRESSBLOCK);
+        unsigned int    stored;
+
+        if (end - source < 4)
+            return false;
+        stored = M_GetLong(source);
+        source += 4;
+
+        if (stored & STOREDBLOCK)
+        {
+            stored &= ~STOREDBLOCK;
+            if ((int)stored != blocklength || end - source < blocklength)
+                return false;
+            memcpy(dest + position, source, blocklength);
+        }
+        else if ((int)stored > end - source
+                 || !M_Decompress(source, stored, dest + position, blocklength))
+            return false;
+        source += stored;
+    }
+    return true;
+}
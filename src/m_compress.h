@@ -0,0 +1,51 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#ifndef __M_COMPRESS__
+#define __M_COMPRESS__
+
+#include "doomtype.h"
+
+// The most M_Compress can write for length bytes
+#define COMPRESSBOUND(length)   ((length) + (length) / 255 + 16)
+
+// The most that can be compressed at once, as matches are found
+//  no further back than this.
+#define COMPRESSBLOCK           65536
+
+// The most M_CompressBlocks can write for length bytes
+#define COMPRESSBLOCKSBOUND(length) \
+    ((length) + ((length) / COMPRESSBLOCK + 1) * 4 + COMPRESSBLOCK / 255 + 16)
+
+int M_Compress(const byte *source, int length, byte *dest);
+boolean M_Decompress(const byte *source, int length, byte *dest, int destlength);
+
+int M_CompressBlocks(const byte *source, int length, byte *dest);
+boolean M_DecompressBlocks(const byte *source, int length, byte *dest, int destlength);
+
+#endif
@@ -61,6 +61,7 @@ extern int      key_speed;
 
 extern int      key_nextweapon;
 extern int      key_prevweapon;
+extern int      key_rewind;
 
 extern int      mousebfire;
 
@@ -104,6 +105,8 @@ extern int screenwidth;
 extern int screenheight;
 extern int widescreen;
 extern char *videodriver;
+extern int renderthreads;
+extern int precachememory;
 extern int usegamma;
 
 extern float mouse_acceleration;
@@ -195,6 +198,7 @@ static default_t        doom_defaults_list[] =
     CONFIG_VARIABLE_KEY   (key_speed,          key_speed,          3),
     CONFIG_VARIABLE_KEY   (key_prevweapon,     key_prevweapon,     3),
     CONFIG_VARIABLE_KEY   (key_nextweapon,     key_nextweapon,     3),
+    CONFIG_VARIABLE_KEY   (key_rewind,         key_rewind,         3),
     CONFIG_VARIABLE_INT   (mouse_fire,         mousebfire,         4),
     CONFIG_VARIABLE_INT   (gamepad_automap,    gamepadautomap,     2),
     CONFIG_VARIABLE_INT   (gamepad_fire,       gamepadfire,        2),
@@ -226,7 +230,9 @@ static default_t        doom_defaults_list[] =
     CONFIG_VARIABLE_INT   (screenwidth,        screenwidth,        5),
     CONFIG_VARIABLE_INT   (screenheight,       screenheight,       5),
     CONFIG_VARIABLE_INT   (widescreen,         widescreen,         1),
-    CONFIG_VARIABLE_STRING(videodriver,        videodriver,        0)
+    CONFIG_VARIABLE_STRING(videodriver,        videodriver,        0),
+    CONFIG_VARIABLE_INT   (renderthreads,      renderthreads,      0),
+    CONFIG_VARIABLE_INT   (precache_memory,    precachememory,     0)
 };
 
 static default_collection_t doom_defaults =
@@ -753,6 +753,8 @@ void M_ReadSaveStrings(void)
     int         i;
     char        name[256];
 
+    P_WaitForSaveGame();
+
     for (i = 0; i < load_end; i++)
     {
         strcpy(name, P_SaveGameFile(i));
@@ -790,6 +792,8 @@ boolean M_CheckSaveGame(int choice)
     int             mission;
     int             i;
 
+    P_WaitForSaveGame();
+
     handle = fopen(P_SaveGameFile(itemOn), "rb");
 
     for (i = 0; i < SAVESTRINGSIZE + VERSIONSIZE + 1; i++)
@@ -439,7 +439,7 @@ boolean P_LookForMonsters(mobj_t *actor)
 
     count = 0;
 
-    for (think = thinkercap.next; think != &thinkercap; think = think->next)
+    for (think = thinkerclasscap[th_mobj].cnext; think != &thinkerclasscap[th_mobj]; think = think->cnext)
     {
         if (think->function.acp1 != (actionf_p1)P_MobjThinker)
             continue;           // not a mobj thinker
@@ -562,7 +562,7 @@ void A_KeenDie(mobj_t *mo)
 
     // scan the remaining thinkers
     // to see if all Keens are dead
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
         if (th->function.acp1 != (actionf_p1)P_MobjThinker)
             continue;
@@ -957,6 +957,7 @@ void A_SkelMissile(mobj_t *actor)
 
     mo->x += mo->momx;
     mo->y += mo->momy;
+    P_UpdateBlockThing(mo);
     mo->tracer = actor->target;
 }
 
@@ -1119,7 +1120,7 @@ void A_VileChase(mobj_t *actor)
                 // Call PIT_VileCheck to check
                 // whether object is a corpse
                 // that can be raised.
-                if (!P_BlockThingsIterator(bx, by, PIT_VileCheck))
+                if (!P_BlockThingsNear(bx, by, 0, 0, -1, PIT_VileCheck))
                 {
                     // got one!
                     mobj_t     *temp = actor->target;
@@ -1137,6 +1138,7 @@ void A_VileChase(mobj_t *actor)
 
                     corpsehit->height = info->height;
                     corpsehit->radius = info->radius;
+                    P_UpdateBlockThing(corpsehit);
                     corpsehit->flags = info->flags;
                     corpsehit->flags2 = info->flags2;
                     corpsehit->flags2 &= ~MF2_FLIPPEDCORPSE;
@@ -1587,7 +1589,7 @@ void A_BossDeath(mobj_t *mo)
 
     // scan the remaining thinkers to see
     // if all bosses are dead
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
         if (th->function.acp1 != (actionf_p1)P_MobjThinker)
             continue;
@@ -1691,6 +1693,7 @@ void A_CloseShotgun2(player_t *player, pspdef_t *psp)
 mobj_t *braintargets[32];
 int    numbraintargets;
 int    braintargeton;
+int    brainspiteasy;
 
 void A_BrainAwake(mobj_t *mo)
 {
@@ -1701,8 +1704,8 @@ void A_BrainAwake(mobj_t *mo)
     numbraintargets = 0;
     braintargeton = 0;
 
-    thinker = thinkercap.next;
-    for (thinker = thinkercap.next; thinker != &thinkercap; thinker = thinker->next)
+    thinker = thinkerclasscap[th_mobj].cnext;
+    for (thinker = thinkerclasscap[th_mobj].cnext; thinker != &thinkerclasscap[th_mobj]; thinker = thinker->cnext)
     {
         if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
             continue;           // not a mobj
@@ -1779,10 +1782,8 @@ void A_BrainSpit(mobj_t *mo)
     mobj_t *targ;
     mobj_t *newmobj;
 
-    static int  easy = 0;
-
-    easy ^= 1;
-    if (gameskill <= sk_easy && !easy)
+    brainspiteasy ^= 1;
+    if (gameskill <= sk_easy && !brainspiteasy)
         return;
 
     if (nomonsters)
@@ -52,6 +52,7 @@ void T_FireFlicker(fireflicker_t *flick)
         flick->sector->lightlevel = flick->maxlight - amount;
 
     flick->count = 4;
+    flick->count -= P_SleepThinker(&flick->thinker, flick->count - 1);
 }
 
 //
@@ -99,6 +100,7 @@ void T_LightFlash(lightflash_t *flash)
         flash->sector->lightlevel = flash->maxlight;
         flash->count = (P_Random() & flash->maxtime) + 1;
     }
+    flash->count -= P_SleepThinker(&flash->thinker, flash->count - 1);
 }
 
 //
@@ -149,6 +151,7 @@ void T_StrobeFlash(strobe_t *flash)
         flash->sector->lightlevel = flash->minlight;
         flash->count = flash->darktime;
     }
+    flash->count -= P_SleepThinker(&flash->thinker, flash->count - 1);
 }
 
 //
@@ -73,9 +73,16 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 // both the head and tail of the thinker list
 extern thinker_t        thinkercap;
 
+// both the head and tail of the list for each class, in the same order
+extern thinker_t        thinkerclasscap[NUMTHCLASS];
+
 void P_InitThinkers(void);
 void P_AddThinker(thinker_t *thinker);
+void P_AddMobjThinker(thinker_t *thinker);
 void P_RemoveThinker(thinker_t *thinker);
+int P_SleepThinker(thinker_t *thinker, int tics);
+int P_ThinkerSleepTics(thinker_t *thinker);
+void P_SortThinkers(void);
 
 //
 // P_PSPR
@@ -112,6 +119,14 @@ extern int              bloodSplatQueueSlot;
 
 void P_RespawnSpecials(void);
 
+extern int              mobjcount;
+extern int              peakmobjcount;
+
+void P_InitMobjs(void);
+mobj_t *P_AllocMobj(void);
+void P_RecycleMobjs(void);
+void P_PrintMobjStats(void);
+
 mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
 
 void P_RemoveMobj(mobj_t *th);
@@ -169,7 +184,12 @@ extern fixed_t          lowfloor;
 void P_LineOpening(line_t *linedef);
 
 boolean P_BlockLinesIterator(int x, int y, boolean(*func)(line_t *));
+boolean P_BlockLinesInBox(int x, int y, fixed_t *bbox, boolean(*func)(line_t *));
 boolean P_BlockThingsIterator(int x, int y, boolean(*func)(mobj_t *));
+boolean P_BlockThingsNear(int x, int y, fixed_t cx, fixed_t cy, fixed_t range,
+                          boolean(*func)(mobj_t *));
+void P_UpdateBlockThing(mobj_t *thing);
+void P_SetBlockLinks(int blocknum, mobj_t *first);
 
 #define PT_ADDLINES     1
 #define PT_ADDTHINGS    2
@@ -202,6 +222,10 @@ boolean P_CheckLineSide(mobj_t *actor, fixed_t x, fixed_t y);
 boolean P_TeleportMove(mobj_t *thing, fixed_t x, fixed_t y, fixed_t z);
 void P_SlideMove(mobj_t *mo);
 boolean P_CheckSight(mobj_t *t1, mobj_t *t2);
+void P_ClearSightCache(void);
+void P_PrintSightStats(void);
+
+extern int sightcounts[3];      // rejected, traced and cached sight checks
 void P_UseLines(player_t *player);
 
 boolean P_ChangeSector(sector_t *sector, boolean crunch);
@@ -218,14 +242,37 @@ void P_RadiusAttack(mobj_t *spot, mobj_t *source, int damage);
 // P_SETUP
 //
 extern byte             *rejectmatrix;  // for fast sight rejection
-extern short            *blockmaplump;  // offsets in blockmap are from here
-extern short            *blockmap;
+
+void P_LoadReject(int lumpnum);
+extern int              *blockmaplump;  // offsets in blockmap are from here
+extern int              *blockmap;
+extern fixed_t          *blocklinebox;  // bbox of each line in blockmaplump
 extern int              bmapwidth;
 extern int              bmapheight;     // in mapblocks
 extern fixed_t          bmaporgx;
 extern fixed_t          bmaporgy;       // origin of block map
 extern mobj_t           **blocklinks;   // for thing chains
 
+// The things in each block are also kept in an array, in the same order
+//  as blocklinks, along with where they are, so P_BlockThingsNear can
+//  skip those too far away without following a pointer to each one.
+typedef struct
+{
+    fixed_t             x;
+    fixed_t             y;
+    fixed_t             radius;
+    mobj_t              *mobj;
+} blockthing_t;
+
+typedef struct
+{
+    blockthing_t        *things;
+    int                 numthings;
+    int                 maxthings;
+} blockthings_t;
+
+extern blockthings_t    *blockthings;
+
 //
 // P_INTER
 //
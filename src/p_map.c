@@ -436,7 +436,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 
     for (bx = xl; bx <= xh; bx++)
         for (by = yl; by <= yh; by++)
-            if (!P_BlockThingsIterator(bx, by, PIT_CheckThing))
+            if (!P_BlockThingsNear(bx, by, tmx, tmy, tmthing->radius, PIT_CheckThing))
                 return false;
 
     // check lines
@@ -447,7 +447,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y)
 
     for (bx = xl; bx <= xh; bx++)
         for (by = yl; by <= yh; by++)
-            if (!P_BlockLinesIterator(bx, by, PIT_CheckLine))
+            if (!P_BlockLinesInBox(bx, by, tmbbox, PIT_CheckLine))
                 return false;
 
     return true;
@@ -1296,7 +1296,7 @@ void P_RadiusAttack(mobj_t *spot, mobj_t *source, int damage)
 
     for (y = yl; y <= yh; y++)
         for (x = xl; x <= xh; x++)
-            P_BlockThingsIterator(x, y, PIT_RadiusAttack);
+            P_BlockThingsNear(x, y, spot->x, spot->y, damage << FRACBITS, PIT_RadiusAttack);
 }
 
 //
@@ -1347,6 +1347,7 @@ boolean PIT_ChangeSector(mobj_t *thing)
         thing->flags2 = 0;
         thing->height = 0;
         thing->radius = 0;
+        P_UpdateBlockThing(thing);
 
         S_StartSound(thing, sfx_slop);
 
@@ -1410,6 +1411,9 @@ boolean P_ChangeSector(sector_t *sector, boolean crunch)
 {
     int x, y;
 
+    // heights have changed, so sight may have too
+    P_ClearSightCache();
+
     nofit = false;
     crushchange = crunch;
 
@@ -28,8 +28,11 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 */
 
 #include <stdlib.h>
+#include <string.h>
+#include "doomstat.h"
 #include "m_bbox.h"
 #include "p_local.h"
+#include "z_zone.h"
 
 //
 // P_ApproxDistance
@@ -181,6 +184,100 @@ void P_LineOpening(line_t *linedef)
 // THING POSITION SETTING
 //
 
+//
+// BLOCKTHINGS
+// P_BlockThingsNear can be called again from within its own func (such as
+//  PIT_VileCheck calling P_CheckPosition), and func can link and unlink
+//  things, so where each call has got to is kept here to be adjusted.
+//
+#define MAXBLOCKTHINGSNEAR      8
+
+static struct
+{
+    blockthings_t       *block;
+    int                 i;
+} blockthingsnear[MAXBLOCKTHINGSNEAR];
+
+static int              numblockthingsnear;
+
+static void P_AddBlockThing(mobj_t *thing, int blocknum)
+{
+    blockthings_t       *block = &blockthings[blocknum];
+    blockthing_t        *entry;
+
+    if (block->numthings == block->maxthings)
+    {
+        block->maxthings = (block->maxthings ? block->maxthings * 2 : 4);
+        block->things = (blockthing_t *)Z_Realloc(block->things,
+            block->maxthings * sizeof(*block->things), PU_LEVEL, NULL);
+    }
+    entry = &block->things[block->numthings++];
+    entry->x = thing->x;
+    entry->y = thing->y;
+    entry->radius = thing->radius;
+    entry->mobj = thing;
+    thing->blocknum = blocknum;
+}
+
+static void P_RemoveBlockThing(mobj_t *thing)
+{
+    blockthings_t       *block = &blockthings[thing->blocknum];
+    int                 i = block->numthings - 1;
+    int                 j;
+
+    while (block->things[i].mobj != thing)
+        i--;
+
+    // keep the rest in order
+    memmove(&block->things[i], &block->things[i + 1],
+            (block->numthings - i - 1) * sizeof(*block->things));
+    block->numthings--;
+
+    for (j = 0; j < numblockthingsnear; j++)
+        if (blockthingsnear[j].block == block && i < blockthingsnear[j].i)
+            blockthingsnear[j].i--;
+
+    thing->blocknum = -1;
+}
+
+//
+// P_UpdateBlockThing
+// Called if a thing's x, y or radius is changed without it
+//  being unlinked and linked again.
+//
+void P_UpdateBlockThing(mobj_t *thing)
+{
+    blockthings_t       *block;
+    int                 i;
+
+    if (thing->blocknum < 0)
+        return;
+
+    block = &blockthings[thing->blocknum];
+    for (i = block->numthings - 1; block->things[i].mobj != thing; i--);
+    block->things[i].x = thing->x;
+    block->things[i].y = thing->y;
+    block->things[i].radius = thing->radius;
+}
+
+//
+// P_SetBlockLinks
+// Make first the start of a block's list of things, when its links to
+//  the rest have been loaded from a savegame.
+//
+void P_SetBlockLinks(int blocknum, mobj_t *first)
+{
+    mobj_t      *thing = first;
+
+    blocklinks[blocknum] = first;
+
+    // blockthings are in the opposite order to blocklinks
+    while (thing->bnext)
+        thing = thing->bnext;
+    for (; thing; thing = thing->bprev)
+        P_AddBlockThing(thing, blocknum);
+}
+
 //
 // P_UnsetThingPosition
 // Unlinks a thing from block map and sectors.
@@ -224,6 +321,9 @@ void P_UnsetThingPosition(mobj_t *thing)
                 blocklinks[blocky * bmapwidth + blockx] = thing->bnext;
         }
     }
+
+    if (thing->blocknum >= 0)
+        P_RemoveBlockThing(thing);
 }
 
 //
@@ -274,6 +374,9 @@ void P_SetThingPosition(mobj_t *thing)
                 (*link)->bprev = thing;
 
             *link = thing;
+
+            P_AddBlockThing(thing, blocky * bmapwidth + blockx);
+            return;
         }
         else
         {
@@ -281,6 +384,7 @@ void P_SetThingPosition(mobj_t *thing)
             thing->bnext = thing->bprev = NULL;
         }
     }
+    thing->blocknum = -1;
 }
 
 //
@@ -302,7 +406,7 @@ void P_SetThingPosition(mobj_t *thing)
 boolean P_BlockLinesIterator(int x, int y, boolean (*func)(line_t *))
 {
     int   offset;
-    short *list;
+    int   *list;
 
     if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
         return true;
@@ -326,6 +430,45 @@ boolean P_BlockLinesIterator(int x, int y, boolean (*func)(line_t *))
     return true;        // everything was checked
 }
 
+//
+// P_BlockLinesInBox
+// Like P_BlockLinesIterator, but lines whose bbox doesn't overlap bbox
+//  are skipped using blocklinebox, without reading them from lines[].
+//  func must do nothing but return true for those anyway.
+//
+boolean P_BlockLinesInBox(int x, int y, fixed_t *bbox, boolean (*func)(line_t *))
+{
+    int     offset;
+    int     *list;
+    fixed_t *box;
+
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+        return true;
+
+    offset = blockmap[y * bmapwidth + x] + 1;
+    box = blocklinebox + offset * 4;
+
+    for (list = blockmaplump + offset; *list != -1; list++, box += 4)
+    {
+        line_t *ld;
+
+        if (bbox[BOXRIGHT] <= box[BOXLEFT] || bbox[BOXLEFT] >= box[BOXRIGHT]
+            || bbox[BOXTOP] <= box[BOXBOTTOM] || bbox[BOXBOTTOM] >= box[BOXTOP])
+            continue;
+
+        ld = &lines[*list];
+
+        if (ld->validcount == validcount)
+            continue;   // line has already been checked
+
+        ld->validcount = validcount;
+
+        if (!func(ld))
+            return false;
+    }
+    return true;        // everything was checked
+}
+
 //
 // P_BlockThingsIterator
 //
@@ -344,6 +487,52 @@ boolean P_BlockThingsIterator(int x, int y, boolean (*func)(mobj_t *))
     return true;
 }
 
+//
+// P_BlockThingsNear
+// Like P_BlockThingsIterator, but things further than range from cx, cy
+//  (allowing for their radius) are skipped without calling func, which
+//  must do nothing but return true for those anyway. A negative range
+//  skips nothing.
+// Demos use P_BlockThingsIterator instead, to keep the order blocklinks
+//  ends up in if a thing moves without being linked again.
+//
+boolean P_BlockThingsNear(int x, int y, fixed_t cx, fixed_t cy, fixed_t range,
+                          boolean (*func)(mobj_t *))
+{
+    blockthings_t       *block;
+    int                 *i;
+    boolean             result = true;
+
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+        return true;
+
+    if (demoplayback || demorecording || numblockthingsnear == MAXBLOCKTHINGSNEAR)
+        return P_BlockThingsIterator(x, y, func);
+
+    block = &blockthings[y * bmapwidth + x];
+    blockthingsnear[numblockthingsnear].block = block;
+    i = &blockthingsnear[numblockthingsnear++].i;
+
+    // newest first, as in blocklinks
+    for (*i = block->numthings - 1; *i >= 0; --*i)
+    {
+        blockthing_t    *thing = &block->things[*i];
+
+        if (range >= 0 && (ABS(thing->x - cx) >= thing->radius + range
+                           || ABS(thing->y - cy) >= thing->radius + range))
+            continue;
+
+        if (!func(thing->mobj))
+        {
+            result = false;
+            break;
+        }
+    }
+
+    numblockthingsnear--;
+    return result;
+}
+
 //
 // INTERCEPT ROUTINES
 //
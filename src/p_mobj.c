@@ -462,6 +462,187 @@ void P_MobjThinker(mobj_t *mobj)
     }
 }
 
+//
+// MOBJ ALLOCATION
+// Mobjs are taken from slabs of MOBJSPERSLAB at a time, which are freed
+//  along with everything else in PU_LEVEL when the level ends. Once a
+//  removed mobj has been unlinked by P_RunThinkers, and nothing else
+//  still points to it, P_RecycleMobjs puts it on a free list to be used
+//  again by P_SpawnMobj.
+//
+#define MOBJSPERSLAB    128
+#define RECYCLEBATCH    64
+
+static mobj_t   *mobjslab;
+static int      mobjslabused;
+static mobj_t   *freemobjs;
+
+static mobj_t   **removedmobjs;
+static int      numremovedmobjs;
+static int      maxremovedmobjs;
+
+int             mobjcount;
+int             peakmobjcount;
+static int      slabcount;
+static int      recycledcount;
+
+extern mobj_t   *braintargets[32];
+extern int      numbraintargets;
+
+//
+// P_InitMobjs
+// Called after PU_LEVEL has been freed.
+//
+void P_InitMobjs(void)
+{
+    mobjslab = NULL;
+    mobjslabused = MOBJSPERSLAB;
+    freemobjs = NULL;
+    removedmobjs = NULL;
+    numremovedmobjs = 0;
+    maxremovedmobjs = 0;
+    mobjcount = 0;
+}
+
+//
+// P_AllocMobj
+//
+mobj_t *P_AllocMobj(void)
+{
+    mobj_t      *mobj;
+
+    if (freemobjs)
+    {
+        mobj = freemobjs;
+        freemobjs = (mobj_t *)mobj->thinker.next;
+        ++recycledcount;
+    }
+    else
+    {
+        if (mobjslabused == MOBJSPERSLAB)
+        {
+            mobjslab = (mobj_t *)Z_Malloc(MOBJSPERSLAB * sizeof(*mobjslab), PU_LEVEL, NULL);
+            mobjslabused = 0;
+            ++slabcount;
+        }
+        mobj = &mobjslab[mobjslabused++];
+    }
+
+    if (++mobjcount > peakmobjcount)
+        peakmobjcount = mobjcount;
+
+    return mobj;
+}
+
+static int P_CompareMobjs(const void *a, const void *b)
+{
+    mobj_t      *mobj1 = *(mobj_t **)a;
+    mobj_t      *mobj2 = *(mobj_t **)b;
+
+    return (mobj1 < mobj2 ? -1 : (mobj1 > mobj2));
+}
+
+// Removed mobjs that something still points to are moved to the end of
+//  the candidates, so they are kept for the next time.
+static void P_KeepMobj(mobj_t *mobj, int *numcandidates)
+{
+    mobj_t      **found;
+
+    if (!mobj || !*numcandidates)
+        return;
+
+    found = (mobj_t **)bsearch(&mobj, removedmobjs, *numcandidates,
+                               sizeof(*removedmobjs), P_CompareMobjs);
+    if (found)
+    {
+        int     i = found - removedmobjs;
+
+        // keep the candidates sorted
+        memmove(found, found + 1, (*numcandidates - i - 1) * sizeof(*removedmobjs));
+        removedmobjs[--*numcandidates] = mobj;
+    }
+}
+
+//
+// P_RecycleMobjs
+// Every RECYCLEBATCH removed mobjs, look for any that are no longer
+//  linked or pointed to by anything, and put them on the free list.
+//  Nothing is reused during demos, where stale pointers to removed
+//  mobjs must still find what they pointed to.
+//
+void P_RecycleMobjs(void)
+{
+    thinker_t   *th;
+    int         numcandidates = 0;
+    int         i, j;
+
+    if (numremovedmobjs < RECYCLEBATCH || demoplayback || demorecording)
+        return;
+
+    // candidates are those already unlinked by P_RunThinkers
+    for (i = 0; i < numremovedmobjs; ++i)
+        if (!removedmobjs[i]->thinker.prev)
+        {
+            mobj_t      *mobj = removedmobjs[i];
+
+            removedmobjs[i] = removedmobjs[numcandidates];
+            removedmobjs[numcandidates++] = mobj;
+        }
+    if (!numcandidates)
+        return;
+
+    qsort(removedmobjs, numcandidates, sizeof(*removedmobjs), P_CompareMobjs);
+
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
+        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+        {
+            P_KeepMobj(((mobj_t *)th)->target, &numcandidates);
+            P_KeepMobj(((mobj_t *)th)->tracer, &numcandidates);
+        }
+
+    for (i = 0; i < MAXPLAYERS; ++i)
+        if (playeringame[i])
+        {
+            P_KeepMobj(players[i].mo, &numcandidates);
+            P_KeepMobj(players[i].attacker, &numcandidates);
+        }
+
+    for (i = 0; i < numsectors; ++i)
+        P_KeepMobj(sectors[i].soundtarget, &numcandidates);
+
+    for (i = 0; i < BLOODSPLATQUEUESIZE; ++i)
+        P_KeepMobj(bloodSplatQueue[i], &numcandidates);
+
+    for (i = 0; i < numbraintargets; ++i)
+        P_KeepMobj(braintargets[i], &numcandidates);
+
+    P_KeepMobj(linetarget, &numcandidates);
+
+    for (i = 0, j = 0; i < numremovedmobjs; ++i)
+    {
+        mobj_t  *mobj = removedmobjs[i];
+
+        if (i < numcandidates && !S_OriginIsPlaying(mobj))
+        {
+            mobj->thinker.next = (thinker_t *)freemobjs;
+            freemobjs = mobj;
+        }
+        else
+            removedmobjs[j++] = mobj;
+    }
+    numremovedmobjs = j;
+}
+
+//
+// P_PrintMobjStats
+// Report how many mobjs there are, for -zonestats.
+//
+void P_PrintMobjStats(void)
+{
+    printf("Mobjs: %i live (peak %i), %i slabs of %i, %i reused\n",
+           mobjcount, peakmobjcount, slabcount, MOBJSPERSLAB, recycledcount);
+}
+
 //
 // P_SpawnMobj
 //
@@ -471,7 +652,7 @@ mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
     state_t    *st;
     mobjinfo_t *info;
 
-    mobj = (mobj_t *)Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
+    mobj = P_AllocMobj();
     memset(mobj, 0, sizeof(*mobj));
     info = &mobjinfo[type];
 
@@ -522,7 +703,7 @@ mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 
     mobj->target = mobj->tracer = NULL;
 
-    P_AddThinker(&mobj->thinker);
+    P_AddMobjThinker(&mobj->thinker);
 
     return mobj;
 }
@@ -530,8 +711,8 @@ mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 //
 // P_RemoveMobj
 //
-static mapthing_t itemrespawnqueue[ITEMQUEUESIZE];
-static int        itemrespawntime[ITEMQUEUESIZE];
+mapthing_t        itemrespawnqueue[ITEMQUEUESIZE];
+int               itemrespawntime[ITEMQUEUESIZE];
 int               iqueuehead;
 int               iqueuetail;
 
@@ -576,6 +757,19 @@ void P_RemoveMobj(mobj_t *mobj)
     if (!demorecording && !demoplayback)
         mobj->target = mobj->tracer = NULL;
 
+    // a blood splat may be removed again from bloodSplatQueue
+    if (mobj->thinker.function.acv != (actionf_v)(-1))
+    {
+        if (numremovedmobjs == maxremovedmobjs)
+        {
+            maxremovedmobjs = (maxremovedmobjs ? maxremovedmobjs * 2 : RECYCLEBATCH);
+            removedmobjs = (mobj_t **)Z_Realloc(removedmobjs,
+                maxremovedmobjs * sizeof(*removedmobjs), PU_LEVEL, NULL);
+        }
+        removedmobjs[numremovedmobjs++] = mobj;
+        --mobjcount;
+    }
+
     // free block
     P_RemoveThinker((thinker_t *)mobj);
 }
@@ -963,6 +1157,7 @@ void P_CheckMissileSpawn(mobj_t *th)
     // be computed if it immediately explodes
     th->x += (th->momx >> 1);
     th->y += (th->momy >> 1);
+    P_UpdateBlockThing(th);
     th->z += (th->momz >> 1);
 
     if (!P_TryMove(th, th->x, th->y))
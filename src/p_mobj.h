@@ -264,6 +264,7 @@ typedef struct mobj_s
     // Links in blocks (if needed).
     struct mobj_s       *bnext;
     struct mobj_s       *bprev;
+    int                 blocknum;       // in blockthings, or -1
 
     struct subsector_s  *subsector;
 
@@ -321,6 +322,9 @@ typedef struct mobj_s
     // Thing being chased/attacked for tracers.
     struct mobj_s       *tracer;
 
+    // Index in the savegame, for saving target and tracer.
+    int                 saveindex;
+
     // For bobbing up and down.
     int                floatboblevel;
     int                floatbobdirection;
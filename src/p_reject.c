@@ -0,0 +1,536 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "doomstat.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_bench.h"
+#include "m_config.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "p_local.h"
+#include "SDL.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+//
+// REJECT BUILDER
+// Maps whose REJECT lump is missing, short or all zeros get one built
+//  here, so P_CheckSight can still reject early on them.
+//
+// Sight can only pass from one sector to another through two-sided
+//  lines ("portals"), so for each sector every chain of portals leading
+//  out of it is followed. A straight line through a chain of portals
+//  must cross each of them between where it crosses the first and the
+//  last, so a chain is dropped once any portal in it misses the convex
+//  hull of the first and last. That is only ever true if no line can
+//  pass through the chain, so a sector is never rejected if it could
+//  be seen.
+//
+// Built matrices are cached in the config directory, named after the
+//  MD5 of the map's geometry.
+//
+#define REJECTCACHE     "rejects"
+#define REJECTMAGIC     "DRREJ"
+#define REJECTVERSION   1
+
+#define REJECTTHREADS   4
+
+// Give up following chains out of a sector after this many hull tests,
+//  and treat every sector connected to it as visible.
+#define MAXREJECTTESTS  (1 << 16)
+
+// Once building has taken this long (in ms), every sector left is
+//  treated the same way.
+#define REJECTBUDGET    2000
+
+// How far (in map units) a portal may miss a hull by and still be
+//  counted as inside it.
+#define REJECTEPSILON   1.0
+
+typedef struct
+{
+    char        magic[6];
+    short       version;
+    byte        hash[16];
+} rejectheader_t;
+
+typedef struct
+{
+    double      x1, y1;
+    double      x2, y2;
+    int         sector;         // the sector on the other side
+} portal_t;
+
+typedef struct
+{
+    int         *portals;       // portals leading out of each sector
+    int         *firstportal;
+    portal_t    *portallist;
+    byte        *rows;          // a visible bit for each pair, a row per sector
+    int         rowsize;
+    int         nextsector;
+    int         deadline;
+    SDL_mutex   *lock;
+} rejectbuild_t;
+
+static rejectbuild_t    build;
+
+// Returns true if portal p is further than REJECTEPSILON from the
+//  convex hull of portals a and b along the axis ax, ay.
+static boolean P_SeparatedOnAxis(double ax, double ay, const portal_t *p,
+                                 const portal_t *a, const portal_t *b)
+{
+    double      hull[4];
+    double      pmin, pmax;
+    double      hmin, hmax;
+    double      epsilon;
+    int         i;
+
+    if (!ax && !ay)
+        return false;
+    epsilon = REJECTEPSILON * sqrt(ax * ax + ay * ay);
+
+    hull[0] = a->x1 * ax + a->y1 * ay;
+    hull[1] = a->x2 * ax + a->y2 * ay;
+    hull[2] = b->x1 * ax + b->y1 * ay;
+    hull[3] = b->x2 * ax + b->y2 * ay;
+    hmin = hmax = hull[0];
+    for (i = 1; i < 4; i++)
+    {
+        if (hull[i] < hmin)
+            hmin = hull[i];
+        if (hull[i] > hmax)
+            hmax = hull[i];
+    }
+
+    pmin = p->x1 * ax + p->y1 * ay;
+    pmax = p->x2 * ax + p->y2 * ay;
+    if (pmin > pmax)
+    {
+        double  temp = pmin;
+
+        pmin = pmax;
+        pmax = temp;
+    }
+
+    return (pmin - hmax > epsilon || hmin - pmax > epsilon);
+}
+
+// Returns true if portal p may overlap the convex hull of portals a
+//  and b. The hull's edges are among a, b and the four lines joining
+//  their ends, so testing along those lines, their normals and p's
+//  covers every axis that could separate them.
+static boolean P_PortalInHull(const portal_t *p, const portal_t *a, const portal_t *b)
+{
+    double      edges[7][2];
+    int         i;
+
+    edges[0][0] = a->x2 - a->x1;    edges[0][1] = a->y2 - a->y1;
+    edges[1][0] = b->x2 - b->x1;    edges[1][1] = b->y2 - b->y1;
+    edges[2][0] = p->x2 - p->x1;    edges[2][1] = p->y2 - p->y1;
+    edges[3][0] = b->x1 - a->x1;    edges[3][1] = b->y1 - a->y1;
+    edges[4][0] = b->x2 - a->x1;    edges[4][1] = b->y2 - a->y1;
+    edges[5][0] = b->x1 - a->x2;    edges[5][1] = b->y1 - a->y2;
+    edges[6][0] = b->x2 - a->x2;    edges[6][1] = b->y2 - a->y2;
+
+    for (i = 0; i < 7; i++)
+        if (P_SeparatedOnAxis(edges[i][0], edges[i][1], p, a, b)
+            || P_SeparatedOnAxis(-edges[i][1], edges[i][0], p, a, b))
+            return false;
+
+    return true;
+}
+
+#define SETVISIBLE(row, sector) ((row)[(sector) >> 3] |= 1 << ((sector) & 7))
+
+// Mark every sector connected to source by portals as visible from it.
+static void P_RejectConnected(int source, byte *row, int *stack)
+{
+    int         count = 0;
+
+    // start again, as sectors already marked may not have been followed
+    memset(row, 0, build.rowsize);
+    SETVISIBLE(row, source);
+    stack[count++] = source;
+    while (count)
+    {
+        int     sector = stack[--count];
+        int     i;
+
+        for (i = build.firstportal[sector]; i < build.firstportal[sector + 1]; i++)
+        {
+            int next = build.portallist[build.portals[i]].sector;
+
+            if (!(row[next >> 3] & (1 << (next & 7))))
+            {
+                SETVISIBLE(row, next);
+                stack[count++] = next;
+            }
+        }
+    }
+}
+
+// Follow every chain of portals out of source that a line could pass
+//  through, marking the sectors reached as visible.
+static void P_RejectSector(int source, int *chain, int *next, byte *insector)
+{
+    byte        *row = build.rows + source * build.rowsize;
+    int         depth = 0;
+    int         steps = 0;
+    int         tests = 0;
+
+    if (I_GetTimeMS() > build.deadline)
+    {
+        P_RejectConnected(source, row, chain);
+        return;
+    }
+
+    SETVISIBLE(row, source);
+    insector[source] = 1;
+    next[0] = build.firstportal[source];
+
+    while (depth >= 0)
+    {
+        int     sector = (depth ? build.portallist[chain[depth - 1]].sector : source);
+        int     i = next[depth]++;
+        int     portal;
+        int     to;
+        int     j;
+
+        if (i >= build.firstportal[sector + 1])
+        {
+            // back out of this sector
+            if (depth)
+                insector[sector] = 0;
+            depth--;
+            continue;
+        }
+
+        // each portal is tested against the hull of every one before it
+        tests += depth;
+        if (tests > MAXREJECTTESTS
+            || (!(++steps & 255) && I_GetTimeMS() > build.deadline))
+        {
+            // too many chains to follow, so be safe
+            while (depth > 0)
+                insector[build.portallist[chain[--depth]].sector] = 0;
+            insector[source] = 0;
+            P_RejectConnected(source, row, chain);
+            return;
+        }
+
+        portal = build.portals[i];
+        to = build.portallist[portal].sector;
+        if (insector[to])
+            continue;
+
+        // every portal between the first and this one must be in their hull
+        for (j = 1; j < depth; j++)
+            if (!P_PortalInHull(&build.portallist[chain[j]],
+                                &build.portallist[chain[0]], &build.portallist[portal]))
+                break;
+        if (j < depth)
+            continue;
+
+        SETVISIBLE(row, to);
+        chain[depth++] = portal;
+        insector[to] = 1;
+        next[depth] = build.firstportal[to];
+    }
+    insector[source] = 0;
+}
+
+static int P_RejectThread(void *data)
+{
+    int         *chain = (int *)data;
+    int         *next = chain + numsectors + 1;
+    byte        *insector = (byte *)(next + numsectors + 1);
+
+    while (1)
+    {
+        int     source;
+
+        SDL_mutexP(build.lock);
+        source = build.nextsector++;
+        SDL_mutexV(build.lock);
+
+        if (source >= numsectors)
+            break;
+        P_RejectSector(source, chain, next, insector);
+    }
+    return 0;
+}
+
+// Collect the portals out of each sector. Each two-sided line between
+//  two different sectors is a portal in both directions.
+static void P_RejectPortals(void)
+{
+    int         i;
+    int         count = 0;
+
+    build.firstportal = (int *)Z_Calloc(numsectors + 1, sizeof(int), PU_STATIC, NULL);
+    build.portallist = (portal_t *)Z_Malloc(numlines * 2 * sizeof(portal_t), PU_STATIC, NULL);
+
+    for (i = 0; i < numlines; i++)
+    {
+        line_t  *line = &lines[i];
+        int     front, back;
+
+        if (!line->frontsector || !line->backsector || !(line->flags & ML_TWOSIDED)
+            || line->frontsector == line->backsector)
+            continue;
+
+        front = line->frontsector - sectors;
+        back = line->backsector - sectors;
+
+        build.portallist[count].x1 = line->v1->x / (double)FRACUNIT;
+        build.portallist[count].y1 = line->v1->y / (double)FRACUNIT;
+        build.portallist[count].x2 = line->v2->x / (double)FRACUNIT;
+        build.portallist[count].y2 = line->v2->y / (double)FRACUNIT;
+        build.portallist[count + 1] = build.portallist[count];
+        build.portallist[count].sector = back;
+        build.portallist[count + 1].sector = front;
+        build.firstportal[front + 1]++;
+        build.firstportal[back + 1]++;
+        count += 2;
+    }
+
+    for (i = 0; i < numsectors; i++)
+        build.firstportal[i + 1] += build.firstportal[i];
+
+    build.portals = (int *)Z_Malloc(MAX(count, 1) * sizeof(int), PU_STATIC, NULL);
+    // each sector's start is moved along as its portals are filled in,
+    //  then they are all moved back
+    for (i = 0; i < count; i++)
+    {
+        // portal i leads out of the sector on the other side of its pair
+        int     sector = build.portallist[i ^ 1].sector;
+
+        build.portals[build.firstportal[sector]++] = i;
+    }
+    for (i = numsectors; i > 0; i--)
+        build.firstportal[i] = build.firstportal[i - 1];
+    build.firstportal[0] = 0;
+}
+
+static void P_BuildReject(byte *matrix)
+{
+    SDL_Thread  *threads[REJECTTHREADS];
+    byte        *buffers[REJECTTHREADS];
+    int         size = (numsectors + 1) * 2 * sizeof(int) + numsectors;
+    int         i;
+
+    P_RejectPortals();
+
+    build.rowsize = (numsectors + 7) >> 3;
+    build.rows = (byte *)Z_Calloc(numsectors, build.rowsize, PU_STATIC, NULL);
+    build.nextsector = 0;
+    build.deadline = I_GetTimeMS() + REJECTBUDGET;
+    build.lock = SDL_CreateMutex();
+
+    // the zone isn't thread-safe, so everything the threads use is
+    //  allocated here first
+    for (i = 0; i < REJECTTHREADS; i++)
+        buffers[i] = (byte *)Z_Calloc(1, size, PU_STATIC, NULL);
+
+    for (i = 0; i < REJECTTHREADS; i++)
+        threads[i] = (build.lock ? SDL_CreateThread(P_RejectThread, buffers[i]) : NULL);
+    for (i = 0; i < REJECTTHREADS; i++)
+        if (threads[i])
+            SDL_WaitThread(threads[i], NULL);
+
+    // do any sectors left here, if no threads could be started
+    while (build.nextsector < numsectors)
+        P_RejectSector(build.nextsector++, (int *)buffers[0],
+                       (int *)buffers[0] + numsectors + 1,
+                       buffers[0] + (numsectors + 1) * 2 * sizeof(int));
+
+    if (build.lock)
+        SDL_DestroyMutex(build.lock);
+
+    // pack the rows together into REJECT's layout, where a set bit means
+    //  the sectors can't see each other
+    memset(matrix, 0, (numsectors * numsectors + 7) >> 3);
+    for (i = 0; i < numsectors; i++)
+    {
+        byte    *row = build.rows + i * build.rowsize;
+        int     j;
+
+        for (j = 0; j < numsectors; j++)
+            if (!(row[j >> 3] & (1 << (j & 7))))
+            {
+                int     pnum = i * numsectors + j;
+
+                matrix[pnum >> 3] |= 1 << (pnum & 7);
+            }
+    }
+
+    for (i = 0; i < REJECTTHREADS; i++)
+        Z_Free(buffers[i]);
+    Z_Free(build.rows);
+    Z_Free(build.portals);
+    Z_Free(build.portallist);
+    Z_Free(build.firstportal);
+}
+
+static void P_HashReject(int lumpnum, byte *hash)
+{
+    static const int    maplumps[] = { ML_VERTEXES, ML_LINEDEFS, ML_SIDEDEFS, ML_SECTORS };
+    md5_context_t       md5;
+    int                 i;
+
+    MD5_Init(&md5);
+    for (i = 0; i < sizeof(maplumps) / sizeof(maplumps[0]); i++)
+    {
+        int     lump = lumpnum + maplumps[i];
+
+        MD5_Update(&md5, (byte *)W_CacheLumpNum(lump, PU_STATIC), W_LumpLength(lump));
+        W_ReleaseLumpNum(lump);
+    }
+    MD5_Final(hash, &md5);
+}
+
+static char *P_RejectFilename(byte *hash)
+{
+    char        *filename = (char *)Z_Malloc(strlen(configdir) + strlen(REJECTCACHE) + 38,
+                                             PU_STATIC, NULL);
+    char        *p;
+    int         i;
+
+    p = filename + sprintf(filename, "%s%s%c", configdir, REJECTCACHE, DIR_SEPARATOR);
+    for (i = 0; i < 16; i++)
+        p += sprintf(p, "%02x", hash[i]);
+    strcpy(p, ".lmp");
+    return filename;
+}
+
+static boolean P_ReadRejectCache(char *filename, byte *hash, byte *matrix, int size)
+{
+    FILE                *handle = fopen(filename, "rb");
+    rejectheader_t      header;
+    boolean             result;
+
+    if (!handle)
+        return false;
+
+    result = (fread(&header, sizeof(header), 1, handle) == 1
+              && !memcmp(header.magic, REJECTMAGIC, sizeof(header.magic))
+              && header.version == REJECTVERSION
+              && !memcmp(header.hash, hash, sizeof(header.hash))
+              && fread(matrix, 1, size, handle) == size);
+    fclose(handle);
+    return result;
+}
+
+static void P_WriteRejectCache(char *filename, byte *hash, byte *matrix, int size)
+{
+    FILE                *handle;
+    rejectheader_t      header;
+    boolean             result;
+    char                *dir = (char *)Z_Malloc(strlen(configdir) + strlen(REJECTCACHE) + 1,
+                                                PU_STATIC, NULL);
+
+    sprintf(dir, "%s%s", configdir, REJECTCACHE);
+    M_MakeDirectory(dir);
+    Z_Free(dir);
+
+    // can't write the file, but don't complain
+    if (!(handle = fopen(filename, "wb")))
+        return;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REJECTMAGIC, sizeof(REJECTMAGIC));
+    header.version = REJECTVERSION;
+    memcpy(header.hash, hash, sizeof(header.hash));
+
+    result = (fwrite(&header, sizeof(header), 1, handle) == 1
+              && fwrite(matrix, 1, size, handle) == size);
+    fclose(handle);
+
+    // don't leave a partial file behind
+    if (!result)
+        remove(filename);
+}
+
+//
+// P_LoadReject
+// Must come after P_LoadLineDefs. Demos always use the lump as it is
+//  (padded with zeros if short), as the engine they were recorded with
+//  would have.
+//
+void P_LoadReject(int lumpnum)
+{
+    int         lump = lumpnum + ML_REJECT;
+    int         size = (numsectors * numsectors + 7) >> 3;
+    int         lumplen = W_LumpLength(lump);
+    byte        hash[16];
+    char        *filename;
+    int         starttime;
+    int         i;
+
+    rejectmatrix = (byte *)Z_Malloc(MAX(size, 1), PU_LEVEL, NULL);
+    memset(rejectmatrix, 0, size);
+    if (lumplen)
+    {
+        byte    *data = (byte *)W_CacheLumpNum(lump, PU_STATIC);
+
+        memcpy(rejectmatrix, data, MIN(lumplen, size));
+        W_ReleaseLumpNum(lump);
+    }
+
+    if (demoplayback || demorecording || demoloading || !numsectors)
+        return;
+
+    if (lumplen >= size)
+    {
+        for (i = 0; i < size; i++)
+            if (rejectmatrix[i])
+                return;
+    }
+
+    P_HashReject(lumpnum, hash);
+    filename = P_RejectFilename(hash);
+
+    if (M_CheckParm("-nocache") || !P_ReadRejectCache(filename, hash, rejectmatrix, size))
+    {
+        starttime = I_GetTimeMS();
+        P_BuildReject(rejectmatrix);
+        if (devparm || zonestats || benchmark)
+            printf("Built REJECT for %i sectors in %i ms\n", numsectors,
+                   I_GetTimeMS() - starttime);
+
+        if (!M_CheckParm("-nocache"))
+            P_WriteRejectCache(filename, hash, rejectmatrix, size);
+    }
+    Z_Free(filename);
+}
@@ -29,17 +29,65 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "doomstat.h"
 #include "dstrings.h"
 #include "i_system.h"
+#include "m_compress.h"
+#include "m_misc.h"
 #include "p_local.h"
 #include "p_saveg.h"
+#include "SDL.h"
 #include "z_zone.h"
 
 #define SAVEGAME_EOF 0x1d
 #define VERSIONSIZE  16
 
-FILE    *save_stream;
+MEMFILE *save_stream;
 int     savegamelength;
 boolean savegame_error;
 
+//
+// Savegames are written to memory, then compressed and written to disk
+//  on a thread of their own while the game carries on. The header (as
+//  far as the level time) is left as it is, so the menu can still read
+//  the description and map from it, and is followed by:
+//
+//  SAVEGAMEMAGIC, the format and the length of the rest of the savegame,
+//  then the rest of it as written by M_CompressBlocks.
+//
+// Savegames without SAVEGAMEMAGIC after the header are read as they are.
+//
+// From format 2, the number of things is saved before them, and their
+//  target and tracer are saved as indexes into them (from 1) rather
+//  than as pointers, so they can be restored.
+//
+// From format 3, enough more is saved that a game carries on exactly as
+//  it would have, so demos stay in sync from a snapshot: the order that
+//  thinkers run in (instead of their next pointer), the links between
+//  things in sectors and blocks, sector heights and texture offsets in
+//  full, and what P_ArchiveMisc saves.
+//
+#define SAVEGAMEHEADERSIZE      (SAVESTRINGSIZE + VERSIONSIZE + 4 + MAXPLAYERS + 3)
+#define SAVEGAMEMAGIC           "DRSAVE"
+#define SAVEGAMEFORMAT          3
+#define SAVEGAMEINFOSIZE        (sizeof(SAVEGAMEMAGIC) - 1 + 1 + 4)
+
+static byte             *savegamedata;
+static byte             *savegamepos;
+static byte             *savegameend;
+static int              savegameformat;
+
+// the things loaded so far, by their index in the savegame
+static mobj_t           **savedmobjs;
+static int              numsavedmobjs;
+
+static struct
+{
+    SDL_Thread          *thread;
+    MEMFILE             *stream;
+    FILE                *handle;
+    byte                *output;
+    char                tempfilename[256];
+    char                filename[256];
+} pendingsave;
+
 // Get the filename of a temporary file to write the savegame to. After
 // the file has been successfully saved, it will be renamed to the
 // real file.
@@ -77,13 +125,243 @@ char *P_SaveGameFile(int slot)
     return filename;
 }
 
+static void P_PutLong(byte *p, unsigned int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+static unsigned int P_GetLong(const byte *p)
+{
+    return (p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+}
+
+//
+// P_OpenSaveGame
+// Read a savegame into memory to be loaded.
+//
+boolean P_OpenSaveGame(char *filename)
+{
+    FILE        *handle = fopen(filename, "rb");
+    byte        *data;
+    int         length;
+    int         bodylength;
+    int         position;
+
+    if (!handle)
+        return false;
+
+    length = M_FileLength(handle);
+    data = (byte *)Z_Malloc(MAX(length, 1), PU_STATIC, NULL);
+    if (fread(data, 1, length, handle) < (size_t)length)
+    {
+        fclose(handle);
+        Z_Free(data);
+        return false;
+    }
+    fclose(handle);
+
+    if (length < SAVEGAMEHEADERSIZE + (int)SAVEGAMEINFOSIZE
+        || memcmp(data + SAVEGAMEHEADERSIZE, SAVEGAMEMAGIC, sizeof(SAVEGAMEMAGIC) - 1))
+    {
+        // an older savegame that isn't compressed
+        savegamedata = data;
+        savegamepos = savegamedata;
+        savegameend = savegamedata + length;
+        savegameformat = 0;
+        return true;
+    }
+
+    position = SAVEGAMEHEADERSIZE + sizeof(SAVEGAMEMAGIC) - 1;
+    savegameformat = data[position++];
+    if (savegameformat < 1 || savegameformat > SAVEGAMEFORMAT)
+    {
+        Z_Free(data);
+        return false;
+    }
+    bodylength = P_GetLong(data + position);
+    position += 4;
+
+    // every block takes at least 4 bytes
+    if (bodylength < 0 || bodylength > SAVEGAMESIZE
+        || (bodylength + COMPRESSBLOCK - 1) / COMPRESSBLOCK > (length - position) / 4)
+    {
+        Z_Free(data);
+        return false;
+    }
+
+    savegamedata = (byte *)Z_Malloc(SAVEGAMEHEADERSIZE + bodylength, PU_STATIC, NULL);
+    memcpy(savegamedata, data, SAVEGAMEHEADERSIZE);
+    if (!M_DecompressBlocks(data + position, length - position,
+                            savegamedata + SAVEGAMEHEADERSIZE, bodylength))
+    {
+        // corrupt
+        Z_Free(data);
+        Z_Free(savegamedata);
+        return false;
+    }
+    Z_Free(data);
+
+    savegamepos = savegamedata;
+    savegameend = savegamedata + SAVEGAMEHEADERSIZE + bodylength;
+    return true;
+}
+
+//
+// P_OpenSaveGameBuffer
+// Load a savegame of the current format from memory instead, which is
+//  freed by P_CloseSaveGame.
+//
+void P_OpenSaveGameBuffer(byte *data, int length)
+{
+    savegamedata = savegamepos = data;
+    savegameend = data + length;
+    savegameformat = SAVEGAMEFORMAT;
+}
+
+//
+// P_CloseSaveGame
+// Called once a savegame opened with P_OpenSaveGame has been loaded.
+//
+void P_CloseSaveGame(void)
+{
+    if (savedmobjs)
+    {
+        Z_Free(savedmobjs);
+        savedmobjs = NULL;
+    }
+    Z_Free(savegamedata);
+    savegamedata = savegamepos = savegameend = NULL;
+}
+
+//
+// P_CreateSaveGame
+// Start writing a savegame to save_stream.
+//
+void P_CreateSaveGame(void)
+{
+    P_WaitForSaveGame();
+    save_stream = mem_fopen_write();
+}
+
+//
+// P_SaveGameLength
+// How much has been written to save_stream so far.
+//
+int P_SaveGameLength(void)
+{
+    return mem_ftell(save_stream);
+}
+
+// Compress what was written to save_stream, and write it to the
+//  temporary file before renaming it to the real one.
+static int P_WriteSaveGameThread(void *data)
+{
+    byte        *buffer;
+    size_t      length;
+    byte        *output = pendingsave.output;
+    boolean     result;
+
+    mem_get_buf(pendingsave.stream, (void **)&buffer, &length);
+
+    memcpy(output, buffer, SAVEGAMEHEADERSIZE);
+    output += SAVEGAMEHEADERSIZE;
+    memcpy(output, SAVEGAMEMAGIC, sizeof(SAVEGAMEMAGIC) - 1);
+    output += sizeof(SAVEGAMEMAGIC) - 1;
+    *output++ = SAVEGAMEFORMAT;
+    P_PutLong(output, length - SAVEGAMEHEADERSIZE);
+    output += 4;
+    output += M_CompressBlocks(buffer + SAVEGAMEHEADERSIZE, length - SAVEGAMEHEADERSIZE, output);
+
+    result = (fwrite(pendingsave.output, 1, output - pendingsave.output, pendingsave.handle)
+              == (size_t)(output - pendingsave.output));
+    result &= !fclose(pendingsave.handle);
+
+    // Now rename the temporary savegame file to the actual savegame
+    // file, overwriting the old savegame if there was one there.
+    if (result)
+    {
+        remove(pendingsave.filename);
+        rename(pendingsave.tempfilename, pendingsave.filename);
+    }
+    else
+        remove(pendingsave.tempfilename);
+
+    return 0;
+}
+
+//
+// P_WriteSaveGame
+// Write what has been saved to save_stream to filename, by way of
+//  tempfilename. This happens on another thread, so call
+//  P_WaitForSaveGame before reading any savegames. Returns false if the
+//  temporary file couldn't be created.
+//
+boolean P_WriteSaveGame(char *tempfilename, char *filename)
+{
+    size_t      length = mem_ftell(save_stream);
+
+    // Open the savegame file for writing.  We write to a temporary file
+    // and then rename it at the end if it was successfully written.
+    // This prevents an existing savegame from being overwritten by
+    // a corrupted one, or if a savegame buffer overrun occurs.
+    pendingsave.handle = fopen(tempfilename, "wb");
+    if (!pendingsave.handle)
+    {
+        mem_fclose(save_stream);
+        save_stream = NULL;
+        return false;
+    }
+
+    pendingsave.stream = save_stream;
+    save_stream = NULL;
+    strncpy(pendingsave.tempfilename, tempfilename, sizeof(pendingsave.tempfilename) - 1);
+    strncpy(pendingsave.filename, filename, sizeof(pendingsave.filename) - 1);
+
+    // the zone can't be used by the thread, so allocate enough for the
+    //  worst case here
+    pendingsave.output = (byte *)Z_Malloc(SAVEGAMEHEADERSIZE + SAVEGAMEINFOSIZE
+                                          + COMPRESSBLOCKSBOUND(length - SAVEGAMEHEADERSIZE),
+                                          PU_STATIC, NULL);
+
+    if (!(pendingsave.thread = SDL_CreateThread(P_WriteSaveGameThread, NULL)))
+    {
+        P_WriteSaveGameThread(NULL);
+        P_WaitForSaveGame();
+    }
+    return true;
+}
+
+//
+// P_WaitForSaveGame
+// Wait for a savegame being written by P_WriteSaveGame to be finished.
+//
+void P_WaitForSaveGame(void)
+{
+    if (!pendingsave.stream)
+        return;
+
+    if (pendingsave.thread)
+    {
+        SDL_WaitThread(pendingsave.thread, NULL);
+        pendingsave.thread = NULL;
+    }
+    mem_fclose(pendingsave.stream);
+    pendingsave.stream = NULL;
+    Z_Free(pendingsave.output);
+}
+
 // Endian-safe integer read/write functions
 
 static byte saveg_read8(void)
 {
-    byte result;
+    byte result = 0;
 
-    if (fread(&result, 1, 1, save_stream) < 1)
+    if (savegamepos < savegameend)
+        result = *savegamepos++;
+    else
     {
         if (!savegame_error)
         {
@@ -99,7 +377,7 @@ static byte saveg_read8(void)
 
 static void saveg_write8(byte value)
 {
-    if (fwrite(&value, 1, 1, save_stream) < 1)
+    if (mem_fwrite(&value, 1, 1, save_stream) < 1)
     {
         if (!savegame_error)
         {
@@ -154,7 +432,7 @@ static void saveg_read_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = savegamepos - savegamedata;
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -170,7 +448,7 @@ static void saveg_write_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = mem_ftell(save_stream);
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -192,6 +470,26 @@ static void saveg_writep(void *p)
     saveg_write32((int)p);
 }
 
+// Things are saved as their index, or 0 if they are gone.
+
+static void saveg_write_mobj_index(mobj_t *mobj)
+{
+    if (mobj && mobj->thinker.function.acp1 == (actionf_p1)P_MobjThinker)
+        saveg_write32(mobj->saveindex);
+    else
+        saveg_write32(0);
+}
+
+static mobj_t *saveg_mobj(unsigned int index)
+{
+    return (index <= (unsigned int)numsavedmobjs ? savedmobjs[index] : NULL);
+}
+
+static mobj_t *saveg_read_mobj_index(void)
+{
+    return saveg_mobj(saveg_read32());
+}
+
 // Enum values are 32-bit integers.
 
 #define saveg_read_enum saveg_read32
@@ -275,8 +573,8 @@ static void saveg_read_thinker_t(thinker_t *str)
     // struct thinker_s *prev;
     str->prev = (thinker_t *)saveg_readp();
 
-    // struct thinker_s *next;
-    str->next = (thinker_t *)saveg_readp();
+    // unsigned int order;
+    str->order = saveg_read32();
 
     // think_t function;
     saveg_read_think_t(&str->function);
@@ -287,8 +585,8 @@ static void saveg_write_thinker_t(thinker_t *str)
     // struct thinker_s *prev;
     saveg_writep(str->prev);
 
-    // struct thinker_s *next;
-    saveg_writep(str->next);
+    // unsigned int order;
+    saveg_write32(str->order);
 
     // think_t function;
     saveg_write_think_t(&str->function);
@@ -428,6 +726,9 @@ static void saveg_read_mobj_t(mobj_t *str)
 
     // int floatboblevel;
     str->floatboblevel = saveg_read32();
+
+    // int blocknum;
+    str->blocknum = (savegameformat >= 3 ? saveg_read32() : -1);
 }
 
 static void saveg_write_mobj_t(mobj_t *str)
@@ -445,10 +746,10 @@ static void saveg_write_mobj_t(mobj_t *str)
     saveg_write32(str->z);
 
     // struct mobj_s *snext;
-    saveg_writep(str->snext);
+    saveg_write_mobj_index(str->flags & MF_NOSECTOR ? NULL : str->snext);
 
     // struct mobj_s *sprev;
-    saveg_writep(str->sprev);
+    saveg_write_mobj_index(str->flags & MF_NOSECTOR ? NULL : str->sprev);
 
     // angle_t angle;
     saveg_write32(str->angle);
@@ -460,13 +761,13 @@ static void saveg_write_mobj_t(mobj_t *str)
     saveg_write32(str->frame);
 
     // struct mobj_s *bnext;
-    saveg_writep(str->bnext);
+    saveg_write_mobj_index(str->blocknum < 0 ? NULL : str->bnext);
 
     // struct mobj_s *bprev;
-    saveg_writep(str->bprev);
+    saveg_write_mobj_index(str->blocknum < 0 ? NULL : str->bprev);
 
     // struct subsector_s *subsector;
-    saveg_writep(str->subsector);
+    saveg_write32(str->subsector - subsectors);
 
     // fixed_t floorz;
     saveg_write32(str->floorz);
@@ -520,7 +821,7 @@ static void saveg_write_mobj_t(mobj_t *str)
     saveg_write32(str->movecount);
 
     // struct mobj_s *target;
-    saveg_writep(str->target);
+    saveg_write_mobj_index(str->target);
 
     // int reactiontime;
     saveg_write32(str->reactiontime);
@@ -545,7 +846,7 @@ static void saveg_write_mobj_t(mobj_t *str)
     saveg_write_mapthing_t(&str->spawnpoint);
 
     // struct mobj_s *tracer;
-    saveg_writep(str->tracer);
+    saveg_write_mobj_index(str->tracer);
 
     // int floatbobcount;
     saveg_write32(str->floatbobcount);
@@ -555,6 +856,9 @@ static void saveg_write_mobj_t(mobj_t *str)
 
     // int floatboblevel;
     saveg_write32(str->floatboblevel);
+
+    // int blocknum;
+    saveg_write32(str->blocknum);
 }
 
 //
@@ -1286,8 +1590,8 @@ static void saveg_write_lightflash_t(lightflash_t *str)
     // sector_t *sector;
     saveg_write32(str->sector - sectors);
 
-    // int count;
-    saveg_write32(str->count);
+    // int count; (counting any tics it is asleep for)
+    saveg_write32(str->count + P_ThinkerSleepTics(&str->thinker));
 
     // int maxlight;
     saveg_write32(str->maxlight);
@@ -1341,8 +1645,8 @@ static void saveg_write_strobe_t(strobe_t *str)
     // sector_t *sector;
     saveg_write32(str->sector - sectors);
 
-    // int count;
-    saveg_write32(str->count);
+    // int count; (counting any tics it is asleep for)
+    saveg_write32(str->count + P_ThinkerSleepTics(&str->thinker));
 
     // int minlight;
     saveg_write32(str->minlight);
@@ -1429,8 +1733,8 @@ static void saveg_write_fireflicker_t(fireflicker_t *str)
     // sector_t *sector;
     saveg_write32(str->sector - sectors);
 
-    // int count;
-    saveg_write32(str->count);
+    // int count; (counting any tics it is asleep for)
+    saveg_write32(str->count + P_ThinkerSleepTics(&str->thinker));
 
     // int minlight;
     saveg_write32(str->minlight);
@@ -1626,8 +1930,8 @@ void P_ArchiveWorld(void)
     // do sectors
     for (i = 0, sec = sectors; i < numsectors; i++, sec++)
     {
-        saveg_write16(sec->floorheight >> FRACBITS);
-        saveg_write16(sec->ceilingheight >> FRACBITS);
+        saveg_write32(sec->floorheight);
+        saveg_write32(sec->ceilingheight);
         saveg_write16(sec->floorpic);
         saveg_write16(sec->ceilingpic);
         saveg_write16(sec->lightlevel);
@@ -1648,8 +1952,8 @@ void P_ArchiveWorld(void)
 
             si = &sides[li->sidenum[j]];
 
-            saveg_write16(si->textureoffset >> FRACBITS);
-            saveg_write16(si->rowoffset >> FRACBITS);
+            saveg_write32(si->textureoffset);
+            saveg_write32(si->rowoffset);
             saveg_write16(si->toptexture);
             saveg_write16(si->bottomtexture);
             saveg_write16(si->midtexture);
@@ -1671,8 +1975,16 @@ void P_UnArchiveWorld(void)
     // do sectors
     for (i = 0, sec = sectors; i < numsectors; i++, sec++)
     {
-        sec->floorheight = saveg_read16() << FRACBITS;
-        sec->ceilingheight = saveg_read16() << FRACBITS;
+        if (savegameformat >= 3)
+        {
+            sec->floorheight = saveg_read32();
+            sec->ceilingheight = saveg_read32();
+        }
+        else
+        {
+            sec->floorheight = saveg_read16() << FRACBITS;
+            sec->ceilingheight = saveg_read16() << FRACBITS;
+        }
         sec->floorpic = saveg_read16();
         sec->ceilingpic = saveg_read16();
         sec->lightlevel = saveg_read16();
@@ -1693,8 +2005,16 @@ void P_UnArchiveWorld(void)
             if (li->sidenum[j] == -1)
                 continue;
             si = &sides[li->sidenum[j]];
-            si->textureoffset = saveg_read16() << FRACBITS;
-            si->rowoffset = saveg_read16() << FRACBITS;
+            if (savegameformat >= 3)
+            {
+                si->textureoffset = saveg_read32();
+                si->rowoffset = saveg_read32();
+            }
+            else
+            {
+                si->textureoffset = saveg_read16() << FRACBITS;
+                si->rowoffset = saveg_read16() << FRACBITS;
+            }
             si->toptexture = saveg_read16();
             si->bottomtexture = saveg_read16();
             si->midtexture = saveg_read16();
@@ -1718,9 +2038,16 @@ typedef enum
 void P_ArchiveThinkers(void)
 {
     thinker_t           *th;
+    int                 count = 0;
+
+    // number the things, so they can be referred to by target and tracer
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
+        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+            ((mobj_t *)th)->saveindex = ++count;
+    saveg_write32(count);
 
     // save off the current thinkers
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
         if (th->function.acp1 == (actionf_p1)P_MobjThinker)
         {
@@ -1736,6 +2063,49 @@ void P_ArchiveThinkers(void)
     saveg_write8(tc_end);
 }
 
+// Add a thinker that has been loaded, keeping the order it ran in.
+static void saveg_add_thinker(thinker_t *thinker, thclass_t tclass)
+{
+    unsigned int        order = thinker->order;
+
+    if (tclass == th_mobj)
+        P_AddMobjThinker(thinker);
+    else
+        P_AddThinker(thinker);
+
+    if (savegameformat >= 3)
+        thinker->order = order;
+}
+
+// Link a thing that has been loaded into its sector and block in the
+//  same place it was in before, rather than at the front.
+static void P_LinkSavedMobj(mobj_t *mobj)
+{
+    unsigned int        subsector = (unsigned int)mobj->subsector;
+
+    if (subsector >= (unsigned int)numsubsectors)
+        I_Error("Bad savegame");
+    mobj->subsector = &subsectors[subsector];
+
+    if (!(mobj->flags & MF_NOSECTOR))
+    {
+        mobj->snext = saveg_mobj((unsigned int)mobj->snext);
+        mobj->sprev = saveg_mobj((unsigned int)mobj->sprev);
+        if (!mobj->sprev)
+            mobj->subsector->sector->thinglist = mobj;
+    }
+
+    if (mobj->blocknum >= 0)
+    {
+        if (mobj->blocknum >= bmapwidth * bmapheight)
+            I_Error("Bad savegame");
+        mobj->bnext = saveg_mobj((unsigned int)mobj->bnext);
+        mobj->bprev = saveg_mobj((unsigned int)mobj->bprev);
+    }
+    else
+        mobj->bnext = mobj->bprev = NULL;
+}
+
 //
 // P_UnArchiveThinkers
 //
@@ -1745,19 +2115,44 @@ void P_UnArchiveThinkers(void)
     thinker_t           *currentthinker;
     thinker_t           *next;
     mobj_t              *mobj;
+    int                 count = 0;
+    int                 i;
+
+    numsavedmobjs = 0;
+    if (savegameformat >= 2)
+    {
+        count = saveg_read32();
+        if (count < 0 || count > (savegameend - savegamepos) / 4)
+            I_Error("Bad savegame");
+        savedmobjs = (mobj_t **)Z_Malloc((count + 1) * sizeof(*savedmobjs), PU_STATIC, NULL);
+        savedmobjs[0] = NULL;
+    }
 
-    // remove all the current thinkers
-    currentthinker = thinkercap.next;
-    while (currentthinker != &thinkercap)
+    // remove all the current thinkers, including any that are asleep
+    for (i = 0; i < NUMTHCLASS; i++)
     {
-        next = currentthinker->next;
+        currentthinker = thinkerclasscap[i].cnext;
+        while (currentthinker != &thinkerclasscap[i])
+        {
+            next = currentthinker->cnext;
 
-        if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
-            P_RemoveMobj((mobj_t *)currentthinker);
-        else
-            Z_Free(currentthinker);
+            if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
+            {
+                P_RemoveMobj((mobj_t *)currentthinker);
+
+                // it won't be unlinked by P_RunThinkers
+                currentthinker->prev = NULL;
+            }
+            else if (currentthinker->function.acv == (actionf_v)(-1))
+            {
+                // may be a removed mobj, which isn't a block of its own
+                currentthinker->prev = NULL;
+            }
+            else
+                Z_Free(currentthinker);
 
-        currentthinker = next;
+            currentthinker = next;
+        }
     }
     P_InitThinkers();
 
@@ -1768,18 +2163,52 @@ void P_UnArchiveThinkers(void)
         switch (tclass)
         {
             case tc_end:
+                if (savedmobjs)
+                {
+                    if (numsavedmobjs != count)
+                        I_Error("Bad savegame");
+
+                    // now that they are all here, point things at each other
+                    for (i = 1; i <= count; i++)
+                    {
+                        mobj = savedmobjs[i];
+                        mobj->target = saveg_mobj((unsigned int)mobj->target);
+                        mobj->tracer = saveg_mobj((unsigned int)mobj->tracer);
+                        if (savegameformat >= 3)
+                            P_LinkSavedMobj(mobj);
+                    }
+
+                    // then the blocks, which need every thing in them linked
+                    if (savegameformat >= 3)
+                        for (i = 1; i <= count; i++)
+                        {
+                            mobj = savedmobjs[i];
+                            if (mobj->blocknum >= 0 && !mobj->bprev)
+                                P_SetBlockLinks(mobj->blocknum, mobj);
+                        }
+                }
                 return;         // end of list
 
             case tc_mobj:
                 saveg_read_pad();
-                mobj = (mobj_t *)Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
+                mobj = P_AllocMobj();
                 saveg_read_mobj_t(mobj);
 
-                mobj->target = NULL;
-                mobj->tracer = NULL;
-                P_SetThingPosition(mobj);
+                if (savedmobjs)
+                {
+                    if (numsavedmobjs == count)
+                        I_Error("Bad savegame");
+                    savedmobjs[++numsavedmobjs] = mobj;
+                }
+                else
+                {
+                    mobj->target = NULL;
+                    mobj->tracer = NULL;
+                }
+                if (savegameformat < 3)
+                    P_SetThingPosition(mobj);
                 mobj->info = &mobjinfo[mobj->type];
-                if (mobj->type != MT_BLOODSPLAT)
+                if (mobj->type != MT_BLOODSPLAT && savegameformat < 3)
                 {
                     if (mobj->flags2 & MF2_FLIPPEDCORPSE)
                         mobj->flags2 = mobj->info->flags2 | MF2_FLIPPEDCORPSE;
@@ -1787,7 +2216,7 @@ void P_UnArchiveThinkers(void)
                         mobj->flags2 = mobj->info->flags2;
                 }
                 mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
-                P_AddThinker(&mobj->thinker);
+                saveg_add_thinker(&mobj->thinker, th_mobj);
 
                 // [BH] remember keys present in level
                 switch (mobj->sprite)
@@ -1856,7 +2285,7 @@ void P_ArchiveSpecials(void)
     button_t            *button_ptr;
 
     // save off the current thinkers
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_misc].cnext; th != &thinkerclasscap[th_misc]; th = th->cnext)
     {
         if (th->function.acv == (actionf_v)NULL)
         {
@@ -1990,6 +2419,9 @@ void P_UnArchiveSpecials(void)
         switch (tclass)
         {
             case tc_endspecials:
+                // run them in the same order as before
+                if (savegameformat >= 3)
+                    P_SortThinkers();
                 return;          // end of list
 
             case tc_ceiling:
@@ -2001,7 +2433,7 @@ void P_UnArchiveSpecials(void)
                 if (ceiling->thinker.function.acp1)
                     ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
 
-                P_AddThinker(&ceiling->thinker);
+                saveg_add_thinker(&ceiling->thinker, th_misc);
                 P_AddActiveCeiling(ceiling);
                 break;
 
@@ -2011,7 +2443,7 @@ void P_UnArchiveSpecials(void)
                 saveg_read_vldoor_t(door);
                 door->sector->specialdata = door;
                 door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
-                P_AddThinker(&door->thinker);
+                saveg_add_thinker(&door->thinker, th_misc);
                 break;
 
             case tc_floor:
@@ -2020,7 +2452,7 @@ void P_UnArchiveSpecials(void)
                 saveg_read_floormove_t(floor);
                 floor->sector->specialdata = floor;
                 floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
-                P_AddThinker(&floor->thinker);
+                saveg_add_thinker(&floor->thinker, th_misc);
                 break;
 
             case tc_plat:
@@ -2032,7 +2464,7 @@ void P_UnArchiveSpecials(void)
                 if (plat->thinker.function.acp1)
                     plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
 
-                P_AddThinker(&plat->thinker);
+                saveg_add_thinker(&plat->thinker, th_misc);
                 P_AddActivePlat(plat);
                 break;
 
@@ -2041,7 +2473,7 @@ void P_UnArchiveSpecials(void)
                 flash = (lightflash_t *)Z_Malloc(sizeof(*flash), PU_LEVEL, NULL);
                 saveg_read_lightflash_t(flash);
                 flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
-                P_AddThinker(&flash->thinker);
+                saveg_add_thinker(&flash->thinker, th_misc);
                 break;
 
             case tc_strobe:
@@ -2049,7 +2481,7 @@ void P_UnArchiveSpecials(void)
                 strobe = (strobe_t *)Z_Malloc(sizeof(*strobe), PU_LEVEL, NULL);
                 saveg_read_strobe_t(strobe);
                 strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
-                P_AddThinker(&strobe->thinker);
+                saveg_add_thinker(&strobe->thinker, th_misc);
                 break;
 
             case tc_glow:
@@ -2057,7 +2489,7 @@ void P_UnArchiveSpecials(void)
                 glow = (glow_t *)Z_Malloc(sizeof(*glow), PU_LEVEL, NULL);
                 saveg_read_glow_t(glow);
                 glow->thinker.function.acp1 = (actionf_p1)T_Glow;
-                P_AddThinker(&glow->thinker);
+                saveg_add_thinker(&glow->thinker, th_misc);
                 break;
 
             case tc_fireflicker:
@@ -2065,7 +2497,7 @@ void P_UnArchiveSpecials(void)
                 fireflicker = (fireflicker_t *)Z_Malloc(sizeof(*fireflicker), PU_LEVEL, NULL);
                 saveg_read_fireflicker_t(fireflicker);
                 fireflicker->thinker.function.acp1 = (actionf_p1)T_FireFlicker;
-                P_AddThinker(&fireflicker->thinker);
+                saveg_add_thinker(&fireflicker->thinker, th_misc);
                 break;
 
             case tc_button:
@@ -2079,4 +2511,99 @@ void P_UnArchiveSpecials(void)
                 I_Error("P_UnarchiveSpecials: unknown tclass %i in savegame", tclass);
         }
     }
-}
\ No newline at end of file
+}
+
+extern mobj_t   *braintargets[32];
+extern int      numbraintargets;
+extern int      braintargeton;
+extern int      brainspiteasy;
+extern int      bloodSplatQueueSlot;
+
+//
+// P_ArchiveMisc
+// Everything else that decides how the game carries on, which is saved
+//  after the thinkers so things can be saved by their index.
+//
+void P_ArchiveMisc(void)
+{
+    int i;
+
+    saveg_write32(gametic - levelstarttic);
+    saveg_write32(prndindex);
+    saveg_write32(rndindex);
+    saveg_write32(totalkills);
+    saveg_write32(totalitems);
+    saveg_write32(totalsecret);
+
+    for (i = 0; i < MAXPLAYERS; i++)
+        if (playeringame[i])
+            saveg_write_mobj_index(players[i].attacker);
+
+    for (i = 0; i < numsectors; i++)
+        saveg_write_mobj_index(sectors[i].soundtarget);
+
+    saveg_write32(numbraintargets);
+    saveg_write32(braintargeton);
+    saveg_write32(brainspiteasy);
+    for (i = 0; i < numbraintargets; i++)
+        saveg_write_mobj_index(braintargets[i]);
+
+    saveg_write32(iqueuehead);
+    saveg_write32(iqueuetail);
+    for (i = 0; i < ITEMQUEUESIZE; i++)
+    {
+        saveg_write_mapthing_t(&itemrespawnqueue[i]);
+        saveg_write32(itemrespawntime[i]);
+    }
+
+    saveg_write32(bloodSplatQueueSlot);
+    for (i = 0; i < BLOODSPLATQUEUESIZE; i++)
+        saveg_write_mobj_index(bloodSplatQueue[i]);
+}
+
+//
+// P_UnArchiveMisc
+//
+void P_UnArchiveMisc(void)
+{
+    int i;
+
+    if (savegameformat < 3)
+        return;
+
+    levelstarttic = gametic - saveg_read32();
+    prndindex = saveg_read32() & 0xff;
+    rndindex = saveg_read32() & 0xff;
+    totalkills = saveg_read32();
+    totalitems = saveg_read32();
+    totalsecret = saveg_read32();
+
+    for (i = 0; i < MAXPLAYERS; i++)
+        if (playeringame[i])
+            players[i].attacker = saveg_read_mobj_index();
+
+    for (i = 0; i < numsectors; i++)
+        sectors[i].soundtarget = saveg_read_mobj_index();
+
+    numbraintargets = saveg_read32();
+    if (numbraintargets < 0 || numbraintargets > 32)
+        I_Error("Bad savegame");
+    braintargeton = saveg_read32();
+    brainspiteasy = saveg_read32();
+    for (i = 0; i < numbraintargets; i++)
+        braintargets[i] = saveg_read_mobj_index();
+    if (braintargeton < 0 || braintargeton >= MAX(numbraintargets, 1))
+        braintargeton = 0;
+
+    iqueuehead = saveg_read32() & (ITEMQUEUESIZE - 1);
+    iqueuetail = saveg_read32() & (ITEMQUEUESIZE - 1);
+    for (i = 0; i < ITEMQUEUESIZE; i++)
+    {
+        saveg_read_mapthing_t(&itemrespawnqueue[i]);
+        itemrespawntime[i] = saveg_read32();
+    }
+
+    bloodSplatQueueSlot = saveg_read32();
+    for (i = 0; i < BLOODSPLATQUEUESIZE; i++)
+        bloodSplatQueue[i] = saveg_read_mobj_index();
+}
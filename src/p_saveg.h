@@ -31,11 +31,17 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 
 #include <stdio.h>
 
+#include "memio.h"
+
 // maximum size of a savegame description
 
 #define SAVESTRINGSIZE 256
 #define VERSIONSIZE    16
 
+// maximum size of a savegame
+
+#define SAVEGAMESIZE   0x2c0000
+
 // temporary filename to use while saving.
 
 char *P_TempSaveGameFile(void);
@@ -44,6 +50,16 @@ char *P_TempSaveGameFile(void);
 
 char *P_SaveGameFile(int slot);
 
+// Savegame file open/write functions
+
+boolean P_OpenSaveGame(char *filename);
+void P_OpenSaveGameBuffer(byte *data, int length);
+void P_CloseSaveGame(void);
+void P_CreateSaveGame(void);
+int P_SaveGameLength(void);
+boolean P_WriteSaveGame(char *tempfilename, char *filename);
+void P_WaitForSaveGame(void);
+
 // Savegame file header read/write functions
 
 boolean P_ReadSaveGameHeader(void);
@@ -64,8 +80,10 @@ void P_ArchiveThinkers(void);
 void P_UnArchiveThinkers(void);
 void P_ArchiveSpecials(void);
 void P_UnArchiveSpecials(void);
+void P_ArchiveMisc(void);
+void P_UnArchiveMisc(void);
 
-extern FILE *save_stream;
+extern MEMFILE *save_stream;
 extern boolean savegame_error;
 
 
@@ -27,11 +27,13 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
+#include <limits.h>
 #include <math.h>
 #include "doomstat.h"
 #include "g_game.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "p_fix.h"
 #include "p_local.h"
@@ -78,16 +80,20 @@ static int      totallines;
 // Blockmap size.
 int             bmapwidth, bmapheight;  // size in mapblocks
 
-short           *blockmap;
+int             *blockmap;
 
 // offsets in blockmap are from here
-short           *blockmaplump;
+int             *blockmaplump;
+
+// the bbox of the line at each offset in blockmaplump
+fixed_t         *blocklinebox;
 
 // origin of block map
 fixed_t         bmaporgx, bmaporgy;
 
 // for thing chains
 mobj_t          **blocklinks;
+blockthings_t   *blockthings;
 
 // REJECT
 // For fast sight rejection.
@@ -614,32 +620,216 @@ void P_LoadSideDefs(int lump)
 }
 
 //
-// P_LoadBlockMap
+// P_CreateBlockMap
+// Build the blockmap from lines[], for maps without one or whose
+//  BLOCKMAP lump is too big for its 16-bit offsets. Each block's list
+//  is laid out as in the lump: a 0, then the lines, then -1.
 //
-void P_LoadBlockMap(int lump)
+static void P_CreateBlockMap(void)
 {
-    int i;
-    int lumplen = W_LumpLength(lump);
-    int count = lumplen / 2;
+    int         i;
+    int         minx = INT_MAX, miny = INT_MAX;
+    int         maxx = INT_MIN, maxy = INT_MIN;
+    int         numblocks;
+    int         *counts;
+    int         count;
+    int         offset;
+
+    for (i = 0; i < numvertexes; i++)
+    {
+        int     x = vertexes[i].x >> FRACBITS;
+        int     y = vertexes[i].y >> FRACBITS;
+
+        minx = MIN(minx, x);
+        miny = MIN(miny, y);
+        maxx = MAX(maxx, x);
+        maxy = MAX(maxy, y);
+    }
+
+    bmaporgx = minx << FRACBITS;
+    bmaporgy = miny << FRACBITS;
+    bmapwidth = ((maxx - minx) >> MAPBTOFRAC) + 1;
+    bmapheight = ((maxy - miny) >> MAPBTOFRAC) + 1;
+    numblocks = bmapwidth * bmapheight;
+
+    // Count the lines passing through each block, then lay them out.
+    // Each pass tests every block in a line's bbox against the line
+    //  itself, so long diagonals aren't put in blocks they miss.
+    counts = (int *)Z_Calloc(numblocks, sizeof(*counts), PU_STATIC, NULL);
+    for (offset = 0; offset < 2; offset++)
+    {
+        for (i = 0; i < numlines; i++)
+        {
+            line_t      *ld = &lines[i];
+            int         xl = (ld->bbox[BOXLEFT] - bmaporgx) >> MAPBLOCKSHIFT;
+            int         xh = (ld->bbox[BOXRIGHT] - bmaporgx) >> MAPBLOCKSHIFT;
+            int         yl = (ld->bbox[BOXBOTTOM] - bmaporgy) >> MAPBLOCKSHIFT;
+            int         yh = (ld->bbox[BOXTOP] - bmaporgy) >> MAPBLOCKSHIFT;
+            int         bx, by;
+
+            for (by = yl; by <= yh; by++)
+                for (bx = xl; bx <= xh; bx++)
+                {
+                    fixed_t     box[4];
+                    int         block = by * bmapwidth + bx;
+
+                    // one unit bigger, so lines on a block's edge are in
+                    //  the blocks on both sides of it
+                    box[BOXLEFT] = bmaporgx + (bx << MAPBLOCKSHIFT) - FRACUNIT;
+                    box[BOXRIGHT] = box[BOXLEFT] + MAPBLOCKSIZE + 2 * FRACUNIT;
+                    box[BOXBOTTOM] = bmaporgy + (by << MAPBLOCKSHIFT) - FRACUNIT;
+                    box[BOXTOP] = box[BOXBOTTOM] + MAPBLOCKSIZE + 2 * FRACUNIT;
+
+                    if ((ld->slopetype == ST_POSITIVE || ld->slopetype == ST_NEGATIVE)
+                        && P_BoxOnLineSide(box, ld) != -1)
+                        continue;
+
+                    if (!offset)
+                        counts[block]++;
+                    else
+                        blockmaplump[blockmap[block] + ++counts[block]] = i;
+                }
+        }
+
+        if (!offset)
+        {
+            count = 4 + numblocks;
+            for (i = 0; i < numblocks; i++)
+                count += counts[i] + 2;
+
+            blockmaplump = (int *)Z_Malloc(count * sizeof(*blockmaplump), PU_LEVEL, NULL);
+            blockmap = blockmaplump + 4;
+            blockmaplump[0] = minx;
+            blockmaplump[1] = miny;
+            blockmaplump[2] = bmapwidth;
+            blockmaplump[3] = bmapheight;
+
+            count = 4 + numblocks;
+            for (i = 0; i < numblocks; i++)
+            {
+                blockmap[i] = count;
+                blockmaplump[count] = 0;
+                count += counts[i] + 1;
+                blockmaplump[count++] = -1;
+                counts[i] = 0;
+            }
+        }
+    }
+    Z_Free(counts);
+}
 
-    blockmaplump = (short *)Z_Malloc(lumplen, PU_LEVEL, NULL);
-    W_ReadLump(lump, blockmaplump);
+//
+// P_ReadBlockMap
+// Read the BLOCKMAP lump into 32-bit offsets and line numbers. The
+//  16-bit values in it are unsigned, so the lump can address up to 64K
+//  words instead of vanilla's 32K. Returns false if it is missing or
+//  doesn't fit the map.
+//
+static boolean P_ReadBlockMap(int lump)
+{
+    int         i;
+    int         count = W_LumpLength(lump) / 2;
+    short       *data;
+    int         numblocks;
+
+    if (count < 4)
+        return false;
+
+    data = (short *)W_CacheLumpNum(lump, PU_STATIC);
+    numblocks = (unsigned short)SHORT(data[2]) * (unsigned short)SHORT(data[3]);
+
+    if (!numblocks || count < 4 + numblocks)
+    {
+        W_ReleaseLumpNum(lump);
+        return false;
+    }
+
+    blockmaplump = (int *)Z_Malloc(count * sizeof(*blockmaplump), PU_LEVEL, NULL);
     blockmap = blockmaplump + 4;
 
-    // Swap all short integers to native byte ordering.
-    for (i = 0; i < count; i++)
-        blockmaplump[i] = SHORT(blockmaplump[i]);
+    blockmaplump[0] = SHORT(data[0]);
+    blockmaplump[1] = SHORT(data[1]);
+    for (i = 2; i < count; i++)
+    {
+        unsigned short  value = (unsigned short)SHORT(data[i]);
+
+        blockmaplump[i] = (value == 0xffff ? -1 : value);
+    }
+    W_ReleaseLumpNum(lump);
+
+    // Make sure every list is inside the lump, ends, and only has lines
+    //  in it that exist.
+    for (i = 0; i < numblocks; i++)
+    {
+        int     offset = blockmap[i];
+
+        if (offset < 4 + numblocks || offset >= count)
+            break;
+
+        while (++offset < count && blockmaplump[offset] != -1)
+            if (blockmaplump[offset] >= numlines)
+                break;
+
+        if (offset == count || blockmaplump[offset] != -1)
+            break;
+    }
+    if (i < numblocks)
+    {
+        Z_Free(blockmaplump);
+        return false;
+    }
 
-    // Read the header
     bmaporgx = blockmaplump[0] << FRACBITS;
     bmaporgy = blockmaplump[1] << FRACBITS;
     bmapwidth = blockmaplump[2];
     bmapheight = blockmaplump[3];
+    return true;
+}
+
+//
+// P_LoadBlockMap
+// Must come after P_LoadLineDefs, as the blockmap may need to be built
+//  from lines[], and blocklinebox is copied from them.
+//
+void P_LoadBlockMap(int lump)
+{
+    int i;
+    int count;
+
+    //!
+    // @category mod
+    //
+    // Build the blockmap from the map's lines instead of using its
+    // BLOCKMAP lump. Maps whose BLOCKMAP is missing or can't be read are
+    // always built this way.
+    //
+    if (M_CheckParm("-blockmap") || !P_ReadBlockMap(lump))
+        P_CreateBlockMap();
+
+    // Copy the bbox of each line in the lists to beside it, so
+    //  P_BlockLinesInBox can skip lines without reading them.
+    count = 0;
+    for (i = 0; i < bmapwidth * bmapheight; i++)
+        count = MAX(count, blockmap[i]);
+    while (blockmaplump[++count] != -1);
+    blocklinebox = (fixed_t *)Z_Malloc(++count * 4 * sizeof(*blocklinebox), PU_LEVEL, NULL);
+
+    for (i = 0; i < bmapwidth * bmapheight; i++)
+    {
+        int     *list;
+
+        for (list = blockmaplump + blockmap[i] + 1; *list != -1; list++)
+            memcpy(&blocklinebox[(list - blockmaplump) * 4], lines[*list].bbox,
+                   4 * sizeof(*blocklinebox));
+    }
 
     // Clear out mobj chains
     count = sizeof(*blocklinks) * bmapwidth * bmapheight;
     blocklinks = (mobj_t **)Z_Malloc(count, PU_LEVEL, 0);
     memset(blocklinks, 0, count);
+
+    blockthings = (blockthings_t *)Z_Calloc(bmapwidth * bmapheight, sizeof(*blockthings),
+                                            PU_LEVEL, 0);
 }
 
 //
@@ -943,6 +1133,7 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
     Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
 
     P_InitThinkers();
+    P_InitMobjs();
 
     // find map name
     if (gamemode == commercial)
@@ -963,18 +1154,22 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
 
     P_MapName(gameepisode, gamemap);
 
+    // start reading in all of the map's lumps before loading them
+    for (i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+        W_PrefetchLumpNum(lumpnum + i);
+
     // note: most of this ordering is important
-    P_LoadBlockMap(lumpnum + ML_BLOCKMAP);
     P_LoadVertexes(lumpnum + ML_VERTEXES);
     P_LoadSectors(lumpnum + ML_SECTORS);
     P_LoadSideDefs(lumpnum + ML_SIDEDEFS);
 
     P_LoadLineDefs(lumpnum + ML_LINEDEFS);
+    P_LoadBlockMap(lumpnum + ML_BLOCKMAP);
     P_LoadSubsectors(lumpnum + ML_SSECTORS);
     P_LoadNodes(lumpnum + ML_NODES);
     P_LoadSegs(lumpnum + ML_SEGS);
 
-    rejectmatrix = (byte *)W_CacheLumpNum(lumpnum + ML_REJECT, PU_LEVEL);
+    P_LoadReject(lumpnum);
     P_GroupLines();
 
     P_RemoveSlimeTrails();
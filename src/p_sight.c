@@ -26,6 +26,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
+#include <stdio.h>
 #include "p_local.h"
 
 //
@@ -39,7 +40,51 @@ divline_t       strace;                 // from t1 to t2
 fixed_t         t2x;
 fixed_t         t2y;
 
-int             sightcounts[2];
+int             sightcounts[3];
+
+//
+// Sight cache
+// Monsters often check sight to the same target more than once a tic
+//  (P_LookForPlayers, then P_CheckMeleeRange and P_CheckMissileRange),
+//  so traced results are kept until either thing moves, the tic ends or
+//  a sector's height changes. Whether a line blocks sight doesn't depend
+//  on anything else, so a cached result is always the same as tracing.
+//
+#define SIGHTCACHESIZE  512
+
+typedef struct
+{
+    mobj_t              *t1;
+    mobj_t              *t2;
+    fixed_t             x1, y1, z1, height1;
+    fixed_t             x2, y2, z2, height2;
+    unsigned int        epoch;
+    boolean             result;
+} sightcache_t;
+
+static sightcache_t     sightcache[SIGHTCACHESIZE];
+static unsigned int     sightepoch = 1;
+
+//
+// P_ClearSightCache
+// Called at the start of each tic and whenever a sector's floor or
+//  ceiling moves.
+//
+void P_ClearSightCache(void)
+{
+    sightepoch++;
+}
+
+//
+// P_PrintSightStats
+// Report how many sight checks were rejected, traced or cached,
+//  for -zonestats.
+//
+void P_PrintSightStats(void)
+{
+    printf("Sight checks: %i rejected, %i traced, %i cached\n",
+           sightcounts[0], sightcounts[1], sightcounts[2]);
+}
 
 //
 // P_DivlineSide
@@ -224,6 +269,7 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
     int         pnum;
     int         bytenum;
     int         bitnum;
+    sightcache_t *cache;
 
     if (!t1 || !t2)
         return false;
@@ -249,6 +295,19 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
     if (t1->subsector == t2->subsector)
         return true;
 
+    cache = &sightcache[((size_t)t1 / sizeof(mobj_t) * 31 + (size_t)t2 / sizeof(mobj_t))
+                        & (SIGHTCACHESIZE - 1)];
+
+    if (cache->epoch == sightepoch && cache->t1 == t1 && cache->t2 == t2
+        && cache->x1 == t1->x && cache->y1 == t1->y
+        && cache->z1 == t1->z && cache->height1 == t1->height
+        && cache->x2 == t2->x && cache->y2 == t2->y
+        && cache->z2 == t2->z && cache->height2 == t2->height)
+    {
+        sightcounts[2]++;
+        return cache->result;
+    }
+
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
@@ -266,6 +325,18 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
     strace.dx = t2->x - t1->x;
     strace.dy = t2->y - t1->y;
 
+    cache->t1 = t1;
+    cache->t2 = t2;
+    cache->x1 = t1->x;
+    cache->y1 = t1->y;
+    cache->z1 = t1->z;
+    cache->height1 = t1->height;
+    cache->x2 = t2->x;
+    cache->y2 = t2->y;
+    cache->z2 = t2->z;
+    cache->height2 = t2->height;
+    cache->epoch = sightepoch;
+
     // the head node is the last node output
-    return P_CrossBSPNode(numnodes - 1);
+    return (cache->result = P_CrossBSPNode(numnodes - 1));
 }
\ No newline at end of file
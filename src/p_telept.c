@@ -75,8 +75,8 @@ int EV_Teleport(line_t *line, int side, mobj_t *thing)
     {
         if (sectors[i].tag == tag)
         {
-            thinker = thinkercap.next;
-            for (thinker = thinkercap.next; thinker != &thinkercap; thinker = thinker->next)
+            thinker = thinkerclasscap[th_mobj].cnext;
+            for (thinker = thinkerclasscap[th_mobj].cnext; thinker != &thinkerclasscap[th_mobj]; thinker = thinker->cnext)
             {
                 // not a mobj
                 if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
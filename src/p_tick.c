@@ -47,28 +47,72 @@ int     leveltime;
 // Both the head and tail of the thinker list.
 thinker_t       thinkercap;
 
+// Both the head and tail of the list for each class of thinker.
+thinker_t       thinkerclasscap[NUMTHCLASS];
+
+// Sleeping thinkers are taken out of the thinker list, and kept in
+//  these lists by the tic they wake on until then.
+#define SLEEPWHEEL      256
+
+static thinker_t        *sleeping[SLEEPWHEEL];
+
+static unsigned int     thinkerorder;
+
 
 //
 // P_InitThinkers
 //
 void P_InitThinkers(void)
 {
+    int i;
+
     thinkercap.prev = thinkercap.next = &thinkercap;
+
+    for (i = 0; i < NUMTHCLASS; i++)
+        thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
+
+    for (i = 0; i < SLEEPWHEEL; i++)
+        sleeping[i] = NULL;
+    thinkerorder = 0;
 }
 
 
 
 
+static void P_AddThinkerToClass(thinker_t *thinker, thclass_t tclass)
+{
+    thinker_t   *cap = &thinkerclasscap[tclass];
+
+    thinkercap.prev->next = thinker;
+    thinker->next = &thinkercap;
+    thinker->prev = thinkercap.prev;
+    thinkercap.prev = thinker;
+
+    cap->cprev->cnext = thinker;
+    thinker->cnext = cap;
+    thinker->cprev = cap->cprev;
+    cap->cprev = thinker;
+
+    thinker->order = thinkerorder++;
+    thinker->wake = 0;
+}
+
 //
 // P_AddThinker
 // Adds a new thinker at the end of the list.
 //
 void P_AddThinker(thinker_t *thinker)
 {
-    thinkercap.prev->next = thinker;
-    thinker->next = &thinkercap;
-    thinker->prev = thinkercap.prev;
-    thinkercap.prev = thinker;
+    P_AddThinkerToClass(thinker, th_misc);
+}
+
+//
+// P_AddMobjThinker
+// Adds a mobj's thinker at the end of the list, and to the mobj list.
+//
+void P_AddMobjThinker(thinker_t *thinker)
+{
+    P_AddThinkerToClass(thinker, th_mobj);
 }
 
 
@@ -85,26 +129,162 @@ void P_RemoveThinker(thinker_t *thinker)
 
 
 
+//
+// P_SleepThinker
+// Called by a thinker that won't do anything for the next tics tics,
+//  so P_RunThinkers can leave it out until then. It is put back in the
+//  same place in the list when it wakes, so thinkers still call
+//  P_Random in the same order. Returns how many tics it will sleep,
+//  which may be fewer than asked.
+//
+int P_SleepThinker(thinker_t *thinker, int tics)
+{
+    if (tics <= 0)
+        return 0;
+
+    tics = MIN(tics, SLEEPWHEEL - 2);
+    thinker->wake = leveltime + tics + 1;
+    return tics;
+}
+
+
+
+//
+// P_ThinkerSleepTics
+// How many more tics a thinker will sleep for, so that its count can be
+//  saved as if it had been running.
+//
+int P_ThinkerSleepTics(thinker_t *thinker)
+{
+    return (thinker->wake ? thinker->wake - leveltime : 0);
+}
+
+
+
+//
+// P_SortThinkers
+// Put the thinker list back in order, once thinkers have been loaded
+//  with the order they ran in. Each class's list is in order already.
+//
+void P_SortThinkers(void)
+{
+    thinker_t   *mobj = thinkerclasscap[th_mobj].cnext;
+    thinker_t   *misc = thinkerclasscap[th_misc].cnext;
+
+    thinkercap.prev = thinkercap.next = &thinkercap;
+    thinkerorder = 0;
+
+    while (mobj != &thinkerclasscap[th_mobj] || misc != &thinkerclasscap[th_misc])
+    {
+        thinker_t       *thinker;
+
+        if (misc == &thinkerclasscap[th_misc]
+            || (mobj != &thinkerclasscap[th_mobj] && mobj->order < misc->order))
+        {
+            thinker = mobj;
+            mobj = mobj->cnext;
+        }
+        else
+        {
+            thinker = misc;
+            misc = misc->cnext;
+        }
+
+        thinkercap.prev->next = thinker;
+        thinker->next = &thinkercap;
+        thinker->prev = thinkercap.prev;
+        thinkercap.prev = thinker;
+
+        thinkerorder = MAX(thinkerorder, thinker->order + 1);
+    }
+}
+
+
+
+//
+// P_WakeThinkers
+// Take the thinkers due to wake this tic, in the order they were added.
+//
+static thinker_t *P_WakeThinkers(void)
+{
+    thinker_t   *waking = NULL;
+    thinker_t   *thinker = sleeping[leveltime & (SLEEPWHEEL - 1)];
+
+    sleeping[leveltime & (SLEEPWHEEL - 1)] = NULL;
+    while (thinker)
+    {
+        thinker_t   *next = thinker->snext;
+        thinker_t   **link = &waking;
+
+        while (*link && (*link)->order < thinker->order)
+            link = &(*link)->snext;
+        thinker->snext = *link;
+        *link = thinker;
+
+        thinker->wake = 0;
+        thinker = next;
+    }
+    return waking;
+}
+
+
+
 //
 // P_RunThinkers
+// Thinkers are run in the order they were added, whatever their class,
+//  as that decides the order P_Random is called in.
 //
 void P_RunThinkers(void)
 {
     thinker_t   *currentthinker;
+    thinker_t   *waking = P_WakeThinkers();
 
     currentthinker = thinkercap.next;
-    while (currentthinker != &thinkercap)
+    while (currentthinker != &thinkercap || waking)
     {
+        if (waking && (currentthinker == &thinkercap || waking->order < currentthinker->order))
+        {
+            // put it back in its place in the list
+            thinker_t   *thinker = waking;
+
+            waking = waking->snext;
+            thinker->next = currentthinker;
+            thinker->prev = currentthinker->prev;
+            currentthinker->prev->next = thinker;
+            currentthinker->prev = thinker;
+            currentthinker = thinker;
+        }
+
         if (currentthinker->function.acv == (actionf_v)(-1))
         {
             // time to remove it
             currentthinker->next->prev = currentthinker->prev;
             currentthinker->prev->next = currentthinker->next;
+            currentthinker->cnext->cprev = currentthinker->cprev;
+            currentthinker->cprev->cnext = currentthinker->cnext;
+
+            // mark it as no longer linked, so P_RecycleMobjs can reuse it
+            currentthinker->prev = NULL;
         }
-        else
+        else if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
+            P_MobjThinker((mobj_t *)currentthinker);
+        else if (currentthinker->function.acp1)
         {
-            if (currentthinker->function.acp1)
-                currentthinker->function.acp1(currentthinker);
+            currentthinker->function.acp1(currentthinker);
+
+            if (currentthinker->wake)
+            {
+                // it has gone to sleep, so take it out of the list
+                thinker_t       *next = currentthinker->next;
+                thinker_t       **slot = &sleeping[currentthinker->wake & (SLEEPWHEEL - 1)];
+
+                currentthinker->next->prev = currentthinker->prev;
+                currentthinker->prev->next = currentthinker->next;
+                currentthinker->snext = *slot;
+                *slot = currentthinker;
+                currentthinker = next;
+                continue;
+            }
         }
         currentthinker = currentthinker->next;
     }
@@ -133,12 +313,14 @@ void P_Ticker(void)
         return;
     }
 
+    P_ClearSightCache();
 
     for (i = 0; i < MAXPLAYERS; i++)
         if (playeringame[i])
             P_PlayerThink(&players[i]);
 
     P_RunThinkers();
+    P_RecycleMobjs();
     P_UpdateSpecials();
     P_RespawnSpecials();
 
@@ -27,10 +27,15 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
+#include "SDL.h"
+
 #include "doomstat.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_timer.h"
+#include "m_bench.h"
 #include "p_local.h"
+#include "r_local.h"
 #include "r_sky.h"
 #include "w_wad.h"
 #include "z_zone.h"
@@ -291,17 +296,17 @@ void R_DrawColumnInCache(const column_t *patch, byte *cache,
 }
 
 //
-// R_GenerateComposite
+// R_BuildComposite
 // Using the texture definition,
 //  the composite texture is created from the patches,
 //  and each column is cached.
+// If realpatches is given, the patches have already been cached and
+//  nothing in the zone is touched, so it can run on a worker thread.
 //
 // Rewritten by Lee Killough for performance and to fix Medusa bug
 //
-static void R_GenerateComposite(int texnum)
+static void R_BuildComposite(int texnum, byte *block, patch_t **realpatches)
 {
-    byte         *block = (byte *)Z_Malloc(texturecompositesize[texnum], PU_STATIC,
-                                           (void **)&texturecomposite[texnum]);
     texture_t    *texture = textures[texnum];
     // Composite the columns together.
     texpatch_t   *patch = texture->patches;
@@ -313,7 +318,8 @@ static void R_GenerateComposite(int texnum)
 
     for (; --i >= 0; patch++)
     {
-        patch_t   *realpatch = (patch_t *)W_CacheLumpNum(patch->patch, PU_CACHE);
+        patch_t   *realpatch = (realpatches ? *realpatches++ :
+                                 (patch_t *)W_CacheLumpNum(patch->patch, PU_CACHE));
         int       x, x1 = patch->originx, x2 = x1 + SHORT(realpatch->width);
         const int *cofs = realpatch->columnofs - x1;
 
@@ -373,6 +379,17 @@ static void R_GenerateComposite(int texnum)
         }
     free(source);         // free temporary column
     free(marks);          // free transparency marks
+}
+
+//
+// R_GenerateComposite
+//
+static void R_GenerateComposite(int texnum)
+{
+    byte        *block = (byte *)Z_Malloc(texturecompositesize[texnum], PU_STATIC,
+                                          (void **)&texturecomposite[texnum]);
+
+    R_BuildComposite(texnum, block, NULL);
 
     // Now that the texture has been built in column cache,
     // it is purgable from zone memory.
@@ -509,6 +526,206 @@ static void R_GenerateLookup(int texnum)
     free(count);                                        // killough 4/9/98
 }
 
+//
+// Composites for the textures in a level are built ahead of time by
+//  R_PrecacheLevel, on worker threads while the wipe plays. Each is
+//  allocated on the main thread, and its patches locked, before being
+//  queued. A composite stays PU_STATIC until the main thread sees that
+//  it has been built, and R_GetColumn waits for one that hasn't.
+//
+#define MAXCOMPOSITETHREADS     4
+
+enum
+{
+    COMPOSITE_NONE,
+    COMPOSITE_QUEUED,
+    COMPOSITE_BUILT
+};
+
+typedef struct
+{
+    int                 texnum;
+    byte                *block;
+    patch_t             **patches;
+} compositejob_t;
+
+static volatile byte    *compositestate;
+static compositejob_t   *compositejobs;
+static int              numcompositejobs;
+static int              nextcompositejob;
+static int              compositejobsleft;
+static SDL_mutex        *compositemutex;
+static SDL_cond         *compositebuilt;
+static SDL_Thread       *compositethreads[MAXCOMPOSITETHREADS];
+static int              numcompositethreads;
+
+static int R_CompositeThread(void *data)
+{
+    while (1)
+    {
+        compositejob_t  *job;
+
+        SDL_mutexP(compositemutex);
+        if (nextcompositejob == numcompositejobs)
+        {
+            SDL_mutexV(compositemutex);
+            break;
+        }
+        job = &compositejobs[nextcompositejob++];
+        SDL_mutexV(compositemutex);
+
+        R_BuildComposite(job->texnum, job->block, job->patches);
+
+        SDL_mutexP(compositemutex);
+        compositestate[job->texnum] = COMPOSITE_BUILT;
+        --compositejobsleft;
+        SDL_CondBroadcast(compositebuilt);
+        SDL_mutexV(compositemutex);
+    }
+    return 0;
+}
+
+//
+// R_FinishComposite
+// Wait for a queued composite to be built, and make it purgable.
+//
+static void R_FinishComposite(int texnum)
+{
+    if (numcompositethreads)
+    {
+        SDL_mutexP(compositemutex);
+        while (compositestate[texnum] == COMPOSITE_QUEUED)
+            SDL_CondWait(compositebuilt, compositemutex);
+        SDL_mutexV(compositemutex);
+    }
+    Z_ChangeTag(texturecomposite[texnum], PU_CACHE);
+    compositestate[texnum] = COMPOSITE_NONE;
+}
+
+//
+// R_FinishCompositeJobs
+// Wait for all queued composites, and unlock their patches.
+//
+static void R_FinishCompositeJobs(void)
+{
+    int i, j;
+
+    for (i = 0; i < numcompositethreads; i++)
+        SDL_WaitThread(compositethreads[i], NULL);
+
+    for (i = 0; i < numcompositejobs; i++)
+    {
+        compositejob_t  *job = &compositejobs[i];
+        texture_t       *texture = textures[job->texnum];
+
+        if (compositestate[job->texnum] != COMPOSITE_NONE)
+            R_FinishComposite(job->texnum);
+        for (j = 0; j < texture->patchcount; j++)
+            W_ReleaseLumpNum(texture->patches[j].patch);
+        Z_Free(job->patches);
+    }
+
+    if (compositejobs)
+        Z_Free(compositejobs);
+    compositejobs = NULL;
+    numcompositejobs = nextcompositejob = compositejobsleft = 0;
+    numcompositethreads = 0;
+}
+
+//
+// R_UpdateCompositeJobs
+// Called every frame, to tidy up once the workers are done.
+//
+void R_UpdateCompositeJobs(void)
+{
+    int left;
+
+    if (!numcompositethreads)
+        return;
+
+    SDL_mutexP(compositemutex);
+    left = compositejobsleft;
+    SDL_mutexV(compositemutex);
+
+    if (!left)
+        R_FinishCompositeJobs();
+}
+
+//
+// R_QueueComposite
+//
+static void R_QueueComposite(int texnum)
+{
+    texture_t           *texture = textures[texnum];
+    compositejob_t      *job;
+    int                 i;
+
+    if (!lookuptextures[texnum])
+        R_GenerateLookup(texnum);
+
+    // already built, or every column is from a single patch?
+    if (texturecomposite[texnum])
+        return;
+    for (i = 0; i < texture->width; i++)
+        if (texturecolumnlump[texnum][i] == -1)
+            break;
+    if (i == texture->width)
+        return;
+
+    job = &compositejobs[numcompositejobs++];
+    job->texnum = texnum;
+    job->patches = (patch_t **)Z_Malloc(texture->patchcount * sizeof(*job->patches),
+                                        PU_STATIC, NULL);
+    for (i = 0; i < texture->patchcount; i++)
+        job->patches[i] = (patch_t *)W_CacheLumpNum(texture->patches[i].patch, PU_STATIC);
+    job->block = (byte *)Z_Malloc(texturecompositesize[texnum], PU_STATIC,
+                                  (void **)&texturecomposite[texnum]);
+    compositestate[texnum] = COMPOSITE_QUEUED;
+}
+
+//
+// R_StartCompositeJobs
+//
+static void R_StartCompositeJobs(void)
+{
+    int threads = MIN(MAX(numstrips - 1, 1), MAXCOMPOSITETHREADS);
+    int i;
+
+    if (!numcompositejobs)
+        return;
+
+    compositejobsleft = numcompositejobs;
+
+    if (!compositemutex)
+    {
+        compositemutex = SDL_CreateMutex();
+        compositebuilt = SDL_CreateCond();
+    }
+    if (compositemutex && compositebuilt)
+        for (i = 0; i < threads; i++)
+        {
+            if (!(compositethreads[numcompositethreads] =
+                SDL_CreateThread(R_CompositeThread, NULL)))
+                break;
+            numcompositethreads++;
+        }
+
+    // no threads, so build them all now
+    if (!numcompositethreads)
+    {
+        for (i = 0; i < numcompositejobs; i++)
+        {
+            compositejob_t *job = &compositejobs[i];
+
+            R_BuildComposite(job->texnum, job->block, job->patches);
+            compositestate[job->texnum] = COMPOSITE_BUILT;
+        }
+        nextcompositejob = numcompositejobs;
+        compositejobsleft = 0;
+        R_FinishCompositeJobs();
+    }
+}
+
 //
 // R_GetColumn
 //
@@ -529,6 +746,8 @@ byte *R_GetColumn(int tex, int col)
 
     if (!texturecomposite[tex])
         R_GenerateComposite(tex);
+    else if (compositestate[tex])
+        R_FinishComposite(tex);
 
     return (texturecomposite[tex] + ofs);
 }
@@ -719,6 +938,7 @@ static void R_InitTextures(void)
         W_ReleaseLumpName("TEXTURE2");
 
     lookuptextures = (bool *)Z_Malloc(numtextures * sizeof(boolean), PU_STATIC, 0);
+    compositestate = (byte *)Z_Calloc(numtextures, sizeof(*compositestate), PU_STATIC, 0);
 
     for (i = 0; i < numtextures; i++)
         lookuptextures[i] = false;
@@ -942,117 +1162,323 @@ int R_TextureNumForName(char *name)
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
+// The flats, textures and sprites in the level are loaded nearest
+//  the player first, until precachememory (in MB) has been used.
+//  Lumps in memory-mapped WADs are paged in by several threads at
+//  once. Lumps in other WADs are read on this thread.
 //
-int flatmemory;
-int texturememory;
-int spritememory;
+#define PRECACHETHREADS 4
+
+enum
+{
+    PRECACHE_FLAT,
+    PRECACHE_TEXTURE,
+    PRECACHE_SPRITE
+};
+
+typedef struct
+{
+    int         type;
+    int         num;
+    int         distance;
+    int         numlumps;       // counting those used more than once
+} precache_t;
+
+int             precachememory = 64;
+
+int             flatmemory;
+int             texturememory;
+int             spritememory;
+
+static int      *touchlumps;
+static int      numtouchlumps;
+
+static int R_ComparePrecache(const void *a, const void *b)
+{
+    return (((precache_t *)a)->distance - ((precache_t *)b)->distance);
+}
+
+static int R_DistanceFromPlayer(fixed_t x, fixed_t y)
+{
+    mobj_t      *mo = players[consoleplayer].mo;
+
+    return (mo ? P_ApproxDistance(x - mo->x, y - mo->y) >> FRACBITS : 0);
+}
+
+// Read a byte from every page of the lumps given to this thread.
+static int R_TouchLumpsThread(void *data)
+{
+    int i;
+
+    for (i = *(int *)data; i < numtouchlumps; i += PRECACHETHREADS)
+    {
+        lumpinfo_t      *lump = &lumpinfo[touchlumps[i]];
+        volatile byte   *page = lump->wad_file->mapped + lump->position;
+        int             j;
+
+        for (j = 0; j < lump->size; j += 4096)
+            (void)page[j];
+    }
+    return 0;
+}
+
+static void R_TouchLumps(void)
+{
+    static int  start[PRECACHETHREADS];
+    SDL_Thread  *threads[PRECACHETHREADS];
+    int         i;
+
+    for (i = 0; i < PRECACHETHREADS; i++)
+    {
+        start[i] = i;
+        if (!(threads[i] = SDL_CreateThread(R_TouchLumpsThread, &start[i])))
+            R_TouchLumpsThread(&start[i]);
+    }
+    for (i = 0; i < PRECACHETHREADS; i++)
+        if (threads[i])
+            SDL_WaitThread(threads[i], NULL);
+}
+
+// Get the lumps an item uses. A sprite frame without rotations uses the
+//  same lump 8 times, and textures can share patches.
+static void R_PrecacheItemLumps(precache_t *item, int *lumps)
+{
+    int n = 0;
+    int j;
+    int k;
+
+    switch (item->type)
+    {
+        case PRECACHE_FLAT:
+            lumps[n++] = firstflat + item->num;
+            break;
+
+        case PRECACHE_TEXTURE:
+            for (j = 0; j < textures[item->num]->patchcount; j++)
+                lumps[n++] = textures[item->num]->patches[j].patch;
+            break;
+
+        case PRECACHE_SPRITE:
+            for (j = 0; j < sprites[item->num].numframes; j++)
+                for (k = 0; k < 8; k++)
+                    lumps[n++] = firstspritelump + sprites[item->num].spriteframes[j].lump[k];
+            break;
+    }
+}
+
+// Queue a lump to be loaded, unless it already has been. Returns the
+//  memory it will use, or 0 if already queued.
+static int R_PrecacheLump(int lump, byte *lumpqueued)
+{
+    if (lumpqueued[lump])
+        return 0;
+    lumpqueued[lump] = 1;
+
+    W_PrefetchLumpNum(lump);
+    if (lumpinfo[lump].wad_file->mapped)
+        touchlumps[numtouchlumps++] = lump;
+    else
+        W_CacheLumpNum(lump, PU_CACHE);
+    return lumpinfo[lump].size;
+}
 
 void R_PrecacheLevel(void)
 {
-    char          *flatpresent;
-    char          *texturepresent;
-    char          *spritepresent;
+    precache_t    *precache;
+    int           numprecache = 0;
+    int           *distance;
+    byte          *lumpqueued;
+    int           *lumps;
+    int           maxlumps = 0;
+    int64_t       budget = (int64_t)precachememory * 1024 * 1024;
+    int           used = 0;
+    int           loaded[3] = { 0, 0, 0 };
+    int           skipped = 0;
+    uint64_t      starttime = I_GetTimeUS();
 
     int           i;
     int           j;
-    int           k;
-    int           lump;
 
-    texture_t     *texture;
     thinker_t     *th;
-    spriteframe_t *sf;
 
-    if (demoplayback)
-        return;
+    // finish with the last level's composites first
+    R_FinishCompositeJobs();
 
-    // Precache flats.
-    flatpresent = (char *)Z_Malloc(numflats, PU_STATIC, NULL);
-    memset(flatpresent, 0, numflats);
+    precache = (precache_t *)Z_Malloc((numflats + numtextures + numsprites) * sizeof(*precache),
+                                      PU_STATIC, NULL);
+    distance = (int *)Z_Malloc(MAX(numflats, MAX(numtextures, numsprites)) * sizeof(*distance),
+                               PU_STATIC, NULL);
+
+    // Flats, nearest sector first.
+    for (i = 0; i < numflats; i++)
+        distance[i] = -1;
 
     for (i = 0; i < numsectors; i++)
     {
-        flatpresent[sectors[i].floorpic] = 1;
-        flatpresent[sectors[i].ceilingpic] = 1;
-    }
+        int     d = R_DistanceFromPlayer(sectors[i].soundorg.x, sectors[i].soundorg.y);
 
-    flatmemory = 0;
+        if (distance[sectors[i].floorpic] < 0 || d < distance[sectors[i].floorpic])
+            distance[sectors[i].floorpic] = d;
+        if (distance[sectors[i].ceilingpic] < 0 || d < distance[sectors[i].ceilingpic])
+            distance[sectors[i].ceilingpic] = d;
+    }
 
     for (i = 0; i < numflats; i++)
-    {
-        if (flatpresent[i])
+        if (distance[i] >= 0)
         {
-            lump = firstflat + i;
-            flatmemory += lumpinfo[lump].size;
-            W_CacheLumpNum(lump, PU_CACHE);
+            precache[numprecache].type = PRECACHE_FLAT;
+            precache[numprecache].num = i;
+            precache[numprecache].distance = distance[i];
+            precache[numprecache++].numlumps = 1;
         }
-    }
 
-    Z_Free(flatpresent);
-
-    // Precache textures.
-    texturepresent = (char *)Z_Malloc(numtextures, PU_STATIC, NULL);
-    memset(texturepresent, 0, numtextures);
+    // Textures, nearest side first.
+    for (i = 0; i < numtextures; i++)
+        distance[i] = -1;
 
     for (i = 0; i < numsides; i++)
     {
-        texturepresent[sides[i].toptexture] = 1;
-        texturepresent[sides[i].midtexture] = 1;
-        texturepresent[sides[i].bottomtexture] = 1;
+        int     d = R_DistanceFromPlayer(sides[i].sector->soundorg.x,
+                                         sides[i].sector->soundorg.y);
+        int     tex[3];
+
+        tex[0] = sides[i].toptexture;
+        tex[1] = sides[i].midtexture;
+        tex[2] = sides[i].bottomtexture;
+        for (j = 0; j < 3; j++)
+            if (distance[tex[j]] < 0 || d < distance[tex[j]])
+                distance[tex[j]] = d;
     }
 
-    // Sky texture is always present.
+    // Sky texture is always present, and always visible.
     // Note that F_SKY1 is the name used to
     //  indicate a sky floor/ceiling as a flat,
     //  while the sky texture is stored like
     //  a wall texture, with an episode dependend
     //  name.
-    texturepresent[skytexture] = 1;
+    distance[skytexture] = 0;
 
-    texturememory = 0;
     for (i = 0; i < numtextures; i++)
-    {
-        if (!texturepresent[i])
-            continue;
+        if (distance[i] >= 0)
+        {
+            precache[numprecache].type = PRECACHE_TEXTURE;
+            precache[numprecache].num = i;
+            precache[numprecache].distance = distance[i];
+            precache[numprecache].numlumps = textures[i]->patchcount;
+            maxlumps = MAX(maxlumps, textures[i]->patchcount);
+            numprecache++;
+        }
 
-        texture = textures[i];
+    // Sprites, nearest thing first.
+    for (i = 0; i < numsprites; i++)
+        distance[i] = -1;
 
-        for (j = 0; j < texture->patchcount; j++)
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
+        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
         {
-            lump = texture->patches[j].patch;
-            texturememory += lumpinfo[lump].size;
-            W_CacheLumpNum(lump, PU_CACHE);
+            mobj_t  *mo = (mobj_t *)th;
+            int     d = R_DistanceFromPlayer(mo->x, mo->y);
+
+            if (distance[mo->sprite] < 0 || d < distance[mo->sprite])
+                distance[mo->sprite] = d;
         }
-    }
 
-    Z_Free(texturepresent);
+    for (i = 0; i < numsprites; i++)
+        if (distance[i] >= 0)
+        {
+            precache[numprecache].type = PRECACHE_SPRITE;
+            precache[numprecache].num = i;
+            precache[numprecache].distance = distance[i];
+            precache[numprecache].numlumps = sprites[i].numframes * 8;
+            maxlumps = MAX(maxlumps, sprites[i].numframes * 8);
+            numprecache++;
+        }
 
-    // Precache sprites.
-    spritepresent = (char *)Z_Malloc(numsprites, PU_STATIC, NULL);
-    memset(spritepresent, 0, numsprites);
+    Z_Free(distance);
 
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
-    {
-        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-            spritepresent[((mobj_t *)th)->sprite] = 1;
-    }
+    qsort(precache, numprecache, sizeof(*precache), R_ComparePrecache);
 
-    spritememory = 0;
-    for (i = 0; i < numsprites; i++)
+    // Load whatever fits in the budget. Each lump is only counted once,
+    //  by the first item that uses it.
+    lumpqueued = (byte *)Z_Calloc(numlumps, 1, PU_STATIC, NULL);
+    lumps = (int *)Z_Malloc(MAX(maxlumps, 1) * sizeof(*lumps), PU_STATIC, NULL);
+    touchlumps = (int *)Z_Malloc(numlumps * sizeof(*touchlumps), PU_STATIC, NULL);
+    numtouchlumps = 0;
+    flatmemory = texturememory = spritememory = 0;
+
+    for (i = 0; i < numprecache; i++)
     {
-        if (!spritepresent[i])
-            continue;
+        precache_t      *item = &precache[i];
+        int             cost = 0;
+        int             size = 0;
 
-        for (j = 0; j < sprites[i].numframes; j++)
-        {
-            sf = &sprites[i].spriteframes[j];
-            for (k = 0; k < 8; k++)
+        R_PrecacheItemLumps(item, lumps);
+
+        // add up the lumps not already queued, marking them with 2 while
+        //  counting so those used more than once are only counted once
+        for (j = 0; j < item->numlumps; j++)
+            if (!lumpqueued[lumps[j]])
             {
-                lump = firstspritelump + sf->lump[k];
-                spritememory += lumpinfo[lump].size;
-                W_CacheLumpNum(lump, PU_CACHE);
+                lumpqueued[lumps[j]] = 2;
+                cost += lumpinfo[lumps[j]].size;
             }
+        for (j = 0; j < item->numlumps; j++)
+            if (lumpqueued[lumps[j]] == 2)
+                lumpqueued[lumps[j]] = 0;
+
+        if (budget > 0 && used + cost > budget)
+        {
+            // doesn't fit, and won't be used for a composite below
+            item->type = -1;
+            skipped++;
+            continue;
+        }
+        loaded[item->type]++;
+
+        for (j = 0; j < item->numlumps; j++)
+            size += R_PrecacheLump(lumps[j], lumpqueued);
+        used += size;
+
+        switch (item->type)
+        {
+            case PRECACHE_FLAT:
+                flatmemory += size;
+                break;
+
+            case PRECACHE_TEXTURE:
+                texturememory += size;
+                break;
+
+            case PRECACHE_SPRITE:
+                spritememory += size;
+                break;
         }
     }
 
-    Z_Free(spritepresent);
+    if (numtouchlumps)
+        R_TouchLumps();
+
+    Z_Free(touchlumps);
+    Z_Free(lumps);
+    Z_Free(lumpqueued);
+
+    // build composites for the multipatched textures
+    compositejobs = (compositejob_t *)Z_Malloc(numtextures * sizeof(*compositejobs),
+                                               PU_STATIC, NULL);
+    for (i = 0; i < numprecache; i++)
+        if (precache[i].type == PRECACHE_TEXTURE)
+            R_QueueComposite(precache[i].num);
+    R_StartCompositeJobs();
+
+    Z_Free(precache);
+
+    if (devparm || zonestats || benchmark)
+    {
+        printf("R_PrecacheLevel: %i flats, %i textures and %i sprites (%i KB",
+               loaded[PRECACHE_FLAT], loaded[PRECACHE_TEXTURE], loaded[PRECACHE_SPRITE],
+               used / 1024);
+        if (skipped)
+            printf(", %i over budget", skipped);
+        printf(") in %i ms\n", (int)((I_GetTimeUS() - starttime) / 1000));
+    }
 }
@@ -40,6 +40,7 @@ byte *R_GetColumn(int tex, int col);
 // I/O, setting up the stuff.
 void R_InitData(void);
 void R_PrecacheLevel(void);
+void R_UpdateCompositeJobs(void);
 
 
 // Retrieval.
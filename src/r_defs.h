@@ -756,8 +756,9 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 //
-typedef struct
+typedef struct visplane_s
 {
+    struct visplane_s   *next;          // next visplane in hash chain
     fixed_t             height;
     int                 picnum;
     int                 lightlevel;
@@ -27,6 +27,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 */
 
 #include "doomstat.h"
+#include "m_argv.h"
 #include "m_random.h"
 #include "r_local.h"
 #include "v_video.h"
@@ -96,19 +97,20 @@ byte redtogreen[] =
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t *dc_colormap;
-int          dc_x;
-int          dc_yl;
-int          dc_yh;
-fixed_t      dc_iscale;
-fixed_t      dc_texturemid;
-fixed_t      dc_texheight;
-fixed_t      dc_texturefrac;
-boolean      dc_topsparkle;
-boolean      dc_bottomsparkle;
+THREADLOCAL lighttable_t *dc_colormap;
+THREADLOCAL int          dc_x;
+THREADLOCAL int          dc_yl;
+THREADLOCAL int          dc_yh;
+THREADLOCAL fixed_t      dc_iscale;
+THREADLOCAL fixed_t      dc_texturemid;
+THREADLOCAL fixed_t      dc_texheight;
+THREADLOCAL fixed_t      dc_texturefrac;
+THREADLOCAL boolean      dc_topsparkle;
+THREADLOCAL boolean      dc_bottomsparkle;
+THREADLOCAL int          dc_walltier;
 
 // first pixel in a column (possibly virtual)
-byte         *dc_source;
+THREADLOCAL byte         *dc_source;
 
 extern boolean supershotgun;
 
@@ -167,17 +169,124 @@ void R_DrawColumn(void)
     }
 }
 
+//
+// Wall columns are drawn 4 at a time. Adjacent columns are drawn into a
+//  buffer 4 pixels wide, which is then copied to the screen a row at a
+//  time, with one 32-bit write for each row all 4 columns cover. Each
+//  tier of a wall has its own buffer, as the top and bottom tiers of a
+//  two-sided wall are drawn at the same x.
+//
+#define QUADPITCH       4
+
+typedef struct
+{
+    uint32_t    buf[SCREENHEIGHT];
+    int         x;              // columns in buf
+    int         startx;
+    int         yl[4];
+    int         yh[4];
+    int         top;            // rows all columns cover
+    int         bottom;
+} wallquad_t;
+
+static THREADLOCAL wallquad_t   wallquads[NUMWALLTIERS];
+
+static void R_FlushWallQuad(wallquad_t *quad)
+{
+    int     x;
+    int     y;
+    byte    *source;
+    byte    *dest;
+
+    if (quad->x == 4 && quad->top <= quad->bottom)
+    {
+        for (x = 0; x < 4; x++)
+        {
+            source = (byte *)quad->buf + (quad->yl[x] << 2) + x;
+            dest = ylookup[quad->yl[x]] + columnofs[quad->startx + x];
+            for (y = quad->yl[x]; y < quad->top; y++, source += QUADPITCH, dest += SCREENWIDTH)
+                *dest = *source;
+
+            source = (byte *)quad->buf + ((quad->bottom + 1) << 2) + x;
+            dest = ylookup[quad->bottom + 1] + columnofs[quad->startx + x];
+            for (y = quad->bottom + 1; y <= quad->yh[x]; y++, source += QUADPITCH, dest += SCREENWIDTH)
+                *dest = *source;
+        }
+
+        dest = ylookup[quad->top] + columnofs[quad->startx];
+        for (y = quad->top; y <= quad->bottom; y++, dest += SCREENWIDTH)
+            *(uint32_t *)dest = quad->buf[y];
+    }
+    else
+    {
+        for (x = 0; x < quad->x; x++)
+        {
+            source = (byte *)quad->buf + (quad->yl[x] << 2) + x;
+            dest = ylookup[quad->yl[x]] + columnofs[quad->startx + x];
+            for (y = quad->yl[x]; y <= quad->yh[x]; y++, source += QUADPITCH, dest += SCREENWIDTH)
+                *dest = *source;
+        }
+    }
+    quad->x = 0;
+}
+
+//
+// R_FlushWallColumns
+// Copy any wall columns still in the buffers to the screen. Must be
+//  called before anything else is drawn over or blended with them.
+//
+void R_FlushWallColumns(void)
+{
+    int i;
+
+    for (i = 0; i < NUMWALLTIERS; i++)
+        if (wallquads[i].x)
+            R_FlushWallQuad(&wallquads[i]);
+}
+
+//
+// R_NewWallColumn
+// Returns where in the buffer for dc_walltier to draw the column from
+//  dc_yl down, flushing it first if the column isn't next to those
+//  already in it.
+//
+static byte *R_NewWallColumn(void)
+{
+    wallquad_t  *quad = &wallquads[dc_walltier];
+
+    if (quad->x == 4 || (quad->x && quad->startx + quad->x != dc_x))
+        R_FlushWallQuad(quad);
+
+    if (!quad->x)
+    {
+        quad->startx = dc_x;
+        quad->top = dc_yl;
+        quad->bottom = dc_yh;
+    }
+    else
+    {
+        if (dc_yl > quad->top)
+            quad->top = dc_yl;
+        if (dc_yh < quad->bottom)
+            quad->bottom = dc_yh;
+    }
+    quad->yl[quad->x] = dc_yl;
+    quad->yh[quad->x] = dc_yh;
+    return (byte *)quad->buf + (dc_yl << 2) + quad->x++;
+}
+
 void R_DrawWallColumn(void)
 {
     register int32_t       count = dc_yh - dc_yl;
     register byte          *dest;
+    byte                   *top;
     register fixed_t       frac;
     register const fixed_t fracstep = dc_iscale;
 
     if (count++ < 0)
         return;
 
-    dest = ylookup[dc_yl] + columnofs[dc_x];
+    dest = top = R_NewWallColumn();
 
     frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
@@ -192,11 +301,11 @@ void R_DrawWallColumn(void)
             while (--count)
             {
                 *dest = colormap[source[(frac & HEIGHTMASK) >> FRACBITS]];
-                dest += SCREENWIDTH;
+                dest += QUADPITCH;
                 frac += fracstep;
             }
             if (dc_bottomsparkle && !((frac >> FRACBITS) & 2))
-                *dest = *(dest - SCREENWIDTH);
+                *dest = *(dest - QUADPITCH);
             else
                 *dest = colormap[source[(frac & HEIGHTMASK) >> FRACBITS]];
         }
@@ -211,21 +320,21 @@ void R_DrawWallColumn(void)
                 while ((count -= 2) >= 0)
                 {
                     *dest = colormap[source[(frac & _heightmask) >> FRACBITS]];
-                    dest += SCREENWIDTH;
+                    dest += QUADPITCH;
                     frac += fracstep;
                     *dest = colormap[source[(frac & _heightmask) >> FRACBITS]];
-                    dest += SCREENWIDTH;
+                    dest += QUADPITCH;
                     frac += fracstep;
                 }
                 if (count & 1)
                 {
                     if (dc_bottomsparkle && !((frac >> FRACBITS) & 1))
-                        *dest = *(dest - SCREENWIDTH);
+                        *dest = *(dest - QUADPITCH);
                     else
                         *dest = colormap[source[(frac & _heightmask) >> FRACBITS]];
                 }
                 else if (dc_bottomsparkle && !(((frac - fracstep) >> FRACBITS) & 1))
-                    *(dest - SCREENWIDTH) = *(dest - (SCREENWIDTH << 1));
+                    *(dest - QUADPITCH) = *(dest - (QUADPITCH << 1));
             }
             else
             {
@@ -240,13 +349,13 @@ void R_DrawWallColumn(void)
                 while (--count)
                 {
                     *dest = colormap[source[frac >> FRACBITS]];
-                    dest += SCREENWIDTH;
+                    dest += QUADPITCH;
 
                     if ((frac += fracstep) >= (int32_t)heightmask)
                         frac -= heightmask;
                 }
                 if (dc_bottomsparkle && !((frac >> FRACBITS) & 1))
-                    *dest = *(dest - SCREENWIDTH);
+                    *dest = *(dest - QUADPITCH);
                 else
                     *dest = colormap[source[frac >> FRACBITS]];
             }
@@ -254,23 +363,21 @@ void R_DrawWallColumn(void)
     }
 
     if (dc_topsparkle)
-    {
-        dest = ylookup[dc_yl] + columnofs[dc_x];
-        *dest = *(dest + SCREENWIDTH);
-    }
+        *top = *(top + QUADPITCH);
 }
 
 void R_DrawFullbrightWallColumn(byte *colormask)
 {
     register int32_t       count = dc_yh - dc_yl;
     register byte          *dest;
+    byte                   *top;
     register fixed_t       frac;
     register const fixed_t fracstep = dc_iscale;
 
     if (count++ < 0)
         return;
 
-    dest = ylookup[dc_yl] + columnofs[dc_x];
+    dest = top = R_NewWallColumn();
 
     frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
@@ -287,11 +394,11 @@ void R_DrawFullbrightWallColumn(byte *colormask)
                 register byte dot = source[(frac & HEIGHTMASK) >> FRACBITS];
 
                 *dest = (colormask[dot] ? dot : colormap[dot]);
-                dest += SCREENWIDTH;
+                dest += QUADPITCH;
                 frac += fracstep;
             }
             if (dc_bottomsparkle && !((frac >> FRACBITS) & 2))
-                *dest = *(dest - SCREENWIDTH);
+                *dest = *(dest - QUADPITCH);
             else
             {
                 register byte dot = source[(frac & HEIGHTMASK) >> FRACBITS];
@@ -312,17 +419,17 @@ void R_DrawFullbrightWallColumn(byte *colormask)
                     register byte dot = source[(frac & _heightmask) >> FRACBITS];
 
                     *dest = (colormask[dot] ? dot : colormap[dot]);
-                    dest += SCREENWIDTH;
+                    dest += QUADPITCH;
                     frac += fracstep;
                     dot = source[(frac & _heightmask) >> FRACBITS];
                     *dest = (colormask[dot] ? dot : colormap[dot]);
-                    dest += SCREENWIDTH;
+                    dest += QUADPITCH;
                     frac += fracstep;
                 }
                 if (count & 1)
                 {
                     if (dc_bottomsparkle && !((frac >> FRACBITS) & 1))
-                        *dest = *(dest - SCREENWIDTH);
+                        *dest = *(dest - QUADPITCH);
                     else
                     {
                         register byte dot = source[(frac & _heightmask) >> FRACBITS];
@@ -331,7 +438,7 @@ void R_DrawFullbrightWallColumn(byte *colormask)
                     }
                 }
                 else if (dc_bottomsparkle && !(((frac - fracstep) >> FRACBITS) & 1))
-                    *(dest - SCREENWIDTH) = *(dest - (SCREENWIDTH << 1));
+                    *(dest - QUADPITCH) = *(dest - (QUADPITCH << 1));
             }
             else
             {
@@ -348,13 +455,13 @@ void R_DrawFullbrightWallColumn(byte *colormask)
                     register byte dot = source[frac >> FRACBITS];
 
                     *dest = (colormask[dot] ? dot : colormap[dot]);
-                    dest += SCREENWIDTH;
+                    dest += QUADPITCH;
 
                     if ((frac += fracstep) >= (int32_t)heightmask)
                         frac -= heightmask;
                 }
                 if (dc_bottomsparkle && !((frac >> FRACBITS) & 1))
-                    *dest = *(dest - SCREENWIDTH);
+                    *dest = *(dest - QUADPITCH);
                 else
                 {
                     register byte dot = source[frac >> FRACBITS];
@@ -366,10 +473,7 @@ void R_DrawFullbrightWallColumn(byte *colormask)
     }
 
     if (dc_topsparkle)
-    {
-        dest = ylookup[dc_yl] + columnofs[dc_x];
-        *dest = *(dest + SCREENWIDTH);
-    }
+        *top = *(top + QUADPITCH);
 }
 
 void R_DrawPlayerSpriteColumn(void)
@@ -597,8 +701,6 @@ void R_DrawTranslucent50Column(void)
     }
 }
 
-extern boolean megasphere;
-
 void R_DrawTranslucent33Column(void)
 {
     register int32_t       count = dc_yh - dc_yl;
@@ -861,8 +963,6 @@ void R_DrawTranslucentBlue50Column(void)
 //
 // Spectre/Invisibility.
 //
-extern int fuzzpos;
-
 int fuzzrange[3] = { -SCREENWIDTH, 0, SCREENWIDTH };
 
 #define FUZZ(a, b) fuzzrange[M_RandomInt(a + 1, b + 1)]
@@ -999,8 +1099,8 @@ void R_DrawFuzzColumns(void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte *dc_translation;
-byte *translationtables;
+THREADLOCAL byte *dc_translation;
+byte             *translationtables;
 
 void R_DrawTranslatedColumn(void)
 {
@@ -1079,39 +1179,305 @@ void R_InitTranslationTables(void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int          ds_y;
-int          ds_x1;
-int          ds_x2;
+THREADLOCAL int          ds_y;
+THREADLOCAL int          ds_x1;
+THREADLOCAL int          ds_x2;
 
-lighttable_t *ds_colormap;
+THREADLOCAL lighttable_t *ds_colormap;
 
-fixed_t      ds_xfrac;
-fixed_t      ds_yfrac;
-fixed_t      ds_xstep;
-fixed_t      ds_ystep;
+THREADLOCAL fixed_t      ds_xfrac;
+THREADLOCAL fixed_t      ds_yfrac;
+THREADLOCAL fixed_t      ds_xstep;
+THREADLOCAL fixed_t      ds_ystep;
 
 // start of a 64*64 tile image
-byte         *ds_source;
+THREADLOCAL byte         *ds_source;
 
 
 //
-// Draws the actual span.
-void R_DrawSpan(void)
+// R_DrawSpanRow
+// Draws count + 1 pixels of a span. This is the reference that the
+//  SIMD versions below must match exactly.
+//
+static void R_DrawSpanRow(byte *dest, int count, fixed_t xfrac, fixed_t yfrac,
+    fixed_t xstep, fixed_t ystep, const byte *source, const lighttable_t *colormap)
 {
-    byte    *dest = ylookup[ds_y] + columnofs[ds_x1];
-    fixed_t xfrac = ds_xfrac;
-    fixed_t yfrac = ds_yfrac;
-    int     count = ds_x2 - ds_x1;
-
     do
     {
-        *dest++ = ds_colormap[ds_source[((yfrac >> 10) & 4032) | ((xfrac >> 16) & 63)]];
-        xfrac += ds_xstep;
-        yfrac += ds_ystep;
+        *dest++ = colormap[source[((yfrac >> 10) & 4032) | ((xfrac >> 16) & 63)]];
+        xfrac += xstep;
+        yfrac += ystep;
     }
     while (count--);
 }
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SIMDSPANS
+#endif
+
+#if defined(SIMDSPANS)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIMDTARGET(x)
+#else
+#include <cpuid.h>
+#define SIMDTARGET(x) __attribute__((target(x)))
+#endif
+#include <immintrin.h>
+
+//
+// R_DrawSpanRowSSE2
+// Works out the texel offsets of 4 pixels at a time in vector registers.
+//  Each texel is a byte, so they are still looked up one at a time.
+//
+SIMDTARGET("sse2")
+static void R_DrawSpanRowSSE2(byte *dest, int count, fixed_t xfrac, fixed_t yfrac,
+    fixed_t xstep, fixed_t ystep, const byte *source, const lighttable_t *colormap)
+{
+    int pixels = count + 1;
+
+    if (pixels >= 4)
+    {
+        const unsigned int ux = (unsigned int)xfrac;
+        const unsigned int uy = (unsigned int)yfrac;
+        const unsigned int ustepx = (unsigned int)xstep;
+        const unsigned int ustepy = (unsigned int)ystep;
+        const __m128i      xstep4 = _mm_set1_epi32((int)(ustepx * 4));
+        const __m128i      ystep4 = _mm_set1_epi32((int)(ustepy * 4));
+        const __m128i      xmask = _mm_set1_epi32(63);
+        const __m128i      ymask = _mm_set1_epi32(4032);
+        __m128i            x = _mm_setr_epi32((int)ux, (int)(ux + ustepx),
+                               (int)(ux + ustepx * 2), (int)(ux + ustepx * 3));
+        __m128i            y = _mm_setr_epi32((int)uy, (int)(uy + ustepy),
+                               (int)(uy + ustepy * 2), (int)(uy + ustepy * 3));
+        union
+        {
+            __m128i        v;
+            int            i[4];
+        } spot;
+
+        do
+        {
+            spot.v = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(y, 10), ymask),
+                                  _mm_and_si128(_mm_srli_epi32(x, 16), xmask));
+            dest[0] = colormap[source[spot.i[0]]];
+            dest[1] = colormap[source[spot.i[1]]];
+            dest[2] = colormap[source[spot.i[2]]];
+            dest[3] = colormap[source[spot.i[3]]];
+            dest += 4;
+            x = _mm_add_epi32(x, xstep4);
+            y = _mm_add_epi32(y, ystep4);
+            pixels -= 4;
+        }
+        while (pixels >= 4);
+
+        xfrac = _mm_cvtsi128_si32(x);
+        yfrac = _mm_cvtsi128_si32(y);
+    }
+
+    if (pixels > 0)
+        R_DrawSpanRow(dest, pixels - 1, xfrac, yfrac, xstep, ystep, source, colormap);
+}
+
+//
+// R_DrawSpanRowAVX2
+// As above, 8 pixels at a time. Gathers aren't used: they load 32 bits
+//  per lane, and so would read past the end of the flat.
+//
+SIMDTARGET("avx2")
+static void R_DrawSpanRowAVX2(byte *dest, int count, fixed_t xfrac, fixed_t yfrac,
+    fixed_t xstep, fixed_t ystep, const byte *source, const lighttable_t *colormap)
+{
+    int pixels = count + 1;
+
+    if (pixels >= 8)
+    {
+        const __m256i      lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i      xstep8 = _mm256_set1_epi32((int)((unsigned int)xstep * 8));
+        const __m256i      ystep8 = _mm256_set1_epi32((int)((unsigned int)ystep * 8));
+        const __m256i      xmask = _mm256_set1_epi32(63);
+        const __m256i      ymask = _mm256_set1_epi32(4032);
+        __m256i            x = _mm256_add_epi32(_mm256_set1_epi32(xfrac),
+                               _mm256_mullo_epi32(lanes, _mm256_set1_epi32(xstep)));
+        __m256i            y = _mm256_add_epi32(_mm256_set1_epi32(yfrac),
+                               _mm256_mullo_epi32(lanes, _mm256_set1_epi32(ystep)));
+        union
+        {
+            __m256i        v;
+            int            i[8];
+        } spot;
+
+        do
+        {
+            spot.v = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(y, 10), ymask),
+                                     _mm256_and_si256(_mm256_srli_epi32(x, 16), xmask));
+            dest[0] = colormap[source[spot.i[0]]];
+            dest[1] = colormap[source[spot.i[1]]];
+            dest[2] = colormap[source[spot.i[2]]];
+            dest[3] = colormap[source[spot.i[3]]];
+            dest[4] = colormap[source[spot.i[4]]];
+            dest[5] = colormap[source[spot.i[5]]];
+            dest[6] = colormap[source[spot.i[6]]];
+            dest[7] = colormap[source[spot.i[7]]];
+            dest += 8;
+            x = _mm256_add_epi32(x, xstep8);
+            y = _mm256_add_epi32(y, ystep8);
+            pixels -= 8;
+        }
+        while (pixels >= 8);
+
+        xfrac = _mm_cvtsi128_si32(_mm256_castsi256_si128(x));
+        yfrac = _mm_cvtsi128_si32(_mm256_castsi256_si128(y));
+    }
+
+    if (pixels > 0)
+        R_DrawSpanRow(dest, pixels - 1, xfrac, yfrac, xstep, ystep, source, colormap);
+}
+
+//
+// R_CPUID
+//
+static void R_CPUID(int leaf, int regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex(regs, leaf, 0);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//
+// R_CPUHasAVX2
+// The CPU must support AVX2, and the OS must save the YMM registers.
+//
+static boolean R_CPUHasAVX2(void)
+{
+    int                 regs[4];
+    unsigned long long  xcr0;
+
+    R_CPUID(0, regs);
+    if (regs[0] < 7)
+        return false;
+
+    R_CPUID(1, regs);
+    if (!(regs[2] & (1 << 27)))         // OSXSAVE
+        return false;
+
+#if defined(_MSC_VER)
+    xcr0 = _xgetbv(0);
+#else
+    {
+        unsigned int    eax, edx;
+
+        __asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+        xcr0 = ((unsigned long long)edx << 32) | eax;
+    }
+#endif
+    if ((xcr0 & 6) != 6)                // XMM and YMM state
+        return false;
+
+    R_CPUID(7, regs);
+    return !!(regs[1] & (1 << 5));
+}
+
+//
+// R_CPUHasSSE2
+//
+static boolean R_CPUHasSSE2(void)
+{
+    int regs[4];
+
+    R_CPUID(1, regs);
+    return !!(regs[3] & (1 << 26));
+}
+
+#endif
+
+typedef void (*spanrowfunc_t)(byte *, int, fixed_t, fixed_t, fixed_t, fixed_t,
+    const byte *, const lighttable_t *);
+
+static spanrowfunc_t    spanrowfunc = R_DrawSpanRow;
+
+//
+// R_SpanRowMatches
+// Draw a series of made up spans with both the reference and the given
+//  span drawer, and check the results are identical, including that
+//  nothing is written past the end of a span.
+//
+static boolean R_SpanRowMatches(spanrowfunc_t func)
+{
+    static byte         source[64 * 64];
+    static lighttable_t colormap[256];
+    static byte         expected[SCREENWIDTH + 16];
+    static byte         actual[SCREENWIDTH + 16];
+    unsigned int        seed = 1;
+    int                 i;
+
+#define NEXTRAND() (seed = seed * 1103515245 + 12345)
+
+    for (i = 0; i < 64 * 64; i++)
+        source[i] = (byte)(NEXTRAND() >> 16);
+    for (i = 0; i < 256; i++)
+        colormap[i] = (lighttable_t)(NEXTRAND() >> 16);
+
+    for (i = 0; i < 1000; i++)
+    {
+        int     count = (NEXTRAND() >> 8) % SCREENWIDTH;
+        fixed_t xfrac = (fixed_t)NEXTRAND();
+        fixed_t yfrac = (fixed_t)NEXTRAND();
+        fixed_t xstep = (fixed_t)NEXTRAND();
+        fixed_t ystep = (fixed_t)NEXTRAND();
+
+        // mostly small steps, as in a real frame
+        xstep >>= (NEXTRAND() >> 28);
+        ystep >>= (NEXTRAND() >> 28);
+
+        memset(expected, 0, sizeof(expected));
+        memset(actual, 0, sizeof(actual));
+        R_DrawSpanRow(expected, count, xfrac, yfrac, xstep, ystep, source, colormap);
+        func(actual, count, xfrac, yfrac, xstep, ystep, source, colormap);
+        if (memcmp(expected, actual, sizeof(expected)))
+            return false;
+    }
+
+#undef NEXTRAND
+
+    return true;
+}
+
+//
+// R_InitSpanDrawer
+// Pick the fastest span drawer the CPU supports, unless -nosimd is
+//  given. A SIMD drawer that doesn't pass R_SpanRowMatches is not used.
+//
+void R_InitSpanDrawer(void)
+{
+    //!
+    // @category video
+    //
+    // Don't use SSE2 or AVX2 to draw floors and ceilings.
+    //
+
+    if (M_CheckParm("-nosimd"))
+        return;
+
+#if defined(SIMDSPANS)
+    if (R_CPUHasAVX2() && R_SpanRowMatches(R_DrawSpanRowAVX2))
+        spanrowfunc = R_DrawSpanRowAVX2;
+    else if (R_CPUHasSSE2() && R_SpanRowMatches(R_DrawSpanRowSSE2))
+        spanrowfunc = R_DrawSpanRowSSE2;
+#endif
+}
+
+//
+// Draws the actual span.
+void R_DrawSpan(void)
+{
+    spanrowfunc(ylookup[ds_y] + columnofs[ds_x1], ds_x2 - ds_x1, ds_xfrac, ds_yfrac,
+        ds_xstep, ds_ystep, ds_source, ds_colormap);
+}
+
 //
 // R_InitBuffer
 // Creats lookup tables that avoid
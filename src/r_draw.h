@@ -32,19 +32,32 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 
 
 
-extern lighttable_t     *dc_colormap;
-extern int              dc_x;
-extern int              dc_yl;
-extern int              dc_yh;
-extern fixed_t          dc_iscale;
-extern fixed_t          dc_texturemid;
-extern fixed_t          dc_texheight;
-extern fixed_t          dc_texturefrac;
-extern boolean          dc_topsparkle;
-extern boolean          dc_bottomsparkle;
+// Column and span drawing state. Each draw thread has its own copy,
+//  see r_thread.c.
+extern THREADLOCAL lighttable_t *dc_colormap;
+extern THREADLOCAL int          dc_x;
+extern THREADLOCAL int          dc_yl;
+extern THREADLOCAL int          dc_yh;
+extern THREADLOCAL fixed_t      dc_iscale;
+extern THREADLOCAL fixed_t      dc_texturemid;
+extern THREADLOCAL fixed_t      dc_texheight;
+extern THREADLOCAL fixed_t      dc_texturefrac;
+extern THREADLOCAL boolean      dc_topsparkle;
+extern THREADLOCAL boolean      dc_bottomsparkle;
+
+// which tier of a wall a wall column is in
+enum
+{
+    WALLTIER_TOP,
+    WALLTIER_MID,
+    WALLTIER_BOTTOM,
+    NUMWALLTIERS
+};
+
+extern THREADLOCAL int          dc_walltier;
 
 // first pixel in a column
-extern byte             *dc_source;
+extern THREADLOCAL byte         *dc_source;
 
 extern byte             *tinttab;
 extern byte             *tinttab33;
@@ -65,6 +78,7 @@ extern byte             *tinttabblue50;
 void R_DrawColumn(void);
 void R_DrawWallColumn(void);
 void R_DrawFullbrightWallColumn(byte *);
+void R_FlushWallColumns(void);
 void R_DrawSkyColumn(void);
 void R_DrawTranslucentColumn(void);
 void R_DrawTranslucent50Column(void);
@@ -94,28 +108,33 @@ void  R_DrawTranslatedColumn(void);
 
 void R_VideoErase(unsigned int ofs, int count);
 
-extern int              ds_y;
-extern int              ds_x1;
-extern int              ds_x2;
+extern THREADLOCAL int          ds_y;
+extern THREADLOCAL int          ds_x1;
+extern THREADLOCAL int          ds_x2;
 
-extern lighttable_t     *ds_colormap;
+extern THREADLOCAL lighttable_t *ds_colormap;
 
-extern fixed_t          ds_xfrac;
-extern fixed_t          ds_yfrac;
-extern fixed_t          ds_xstep;
-extern fixed_t          ds_ystep;
+extern THREADLOCAL fixed_t      ds_xfrac;
+extern THREADLOCAL fixed_t      ds_yfrac;
+extern THREADLOCAL fixed_t      ds_xstep;
+extern THREADLOCAL fixed_t      ds_ystep;
 
 // start of a 64*64 tile image
-extern byte             *ds_source;
+extern THREADLOCAL byte         *ds_source;
 
-extern byte             *translationtables;
-extern byte             *dc_translation;
+extern byte                     *translationtables;
+extern THREADLOCAL byte         *dc_translation;
+
+extern THREADLOCAL int          fuzzpos;
+extern THREADLOCAL boolean      megasphere;
 
 
 // Span blitting for rows, floor/ceiling.
 // No Spectre effect needed.
 void R_DrawSpan(void);
 
+void R_InitSpanDrawer(void);
+
 
 void R_InitBuffer(int width, int height);
 
@@ -53,5 +53,6 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "r_data.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_thread.h"
 
 #endif          // __R_LOCAL__
\ No newline at end of file
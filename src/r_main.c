@@ -30,6 +30,7 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 
 #include <math.h>
 #include "d_net.h"
+#include "m_bench.h"
 #include "m_menu.h"
 #include "r_local.h"
 #include "r_sky.h"
@@ -43,6 +44,15 @@ int                     viewangleoffset;
 // increment every time a check is made
 int                     validcount = 1;
 
+// renderer statistics, shown in the HUD with -renderstats
+int                     renderstats[NUMRENDERSTATS];
+int                     renderpeaks[NUMRENDERSTATS];
+char                    *renderstatnames[NUMRENDERSTATS] =
+{
+    "drawsegs", "vissprites", "openings", "visplanes"
+};
+boolean                 showrenderstats;
+
 lighttable_t            *fixedcolormap;
 extern lighttable_t     **walllights;
 
@@ -420,6 +430,8 @@ void R_Init(void)
     R_InitLightTables();
     R_InitSkyMap();
     R_InitTranslationTables();
+    R_InitSpanDrawer();
+    R_InitDrawThreads();
 }
 
 //
@@ -474,11 +486,30 @@ void R_SetupFrame(player_t *player)
     validcount++;
 }
 
+//
+// R_UpdateRenderStats
+// Record how much of each growable array this frame used.
+//
+static void R_UpdateRenderStats(void)
+{
+    int i;
+
+    renderstats[rs_drawsegs] = ds_p - drawsegs;
+    renderstats[rs_vissprites] = num_vissprite;
+    renderstats[rs_openings] = lastopening - openings;
+    renderstats[rs_visplanes] = numvisplanes;
+
+    for (i = 0; i < NUMRENDERSTATS; i++)
+        if (renderstats[i] > renderpeaks[i])
+            renderpeaks[i] = renderstats[i];
+}
+
 //
 // R_RenderView
 //
 void R_RenderPlayerView(player_t *player)
 {
+    R_UpdateCompositeJobs();
     R_SetupFrame(player);
 
     // Clear buffers.
@@ -488,7 +519,9 @@ void R_RenderPlayerView(player_t *player)
     if (automapactive)
     {
         // The head node is the last node output.
+        M_BenchStart(bench_bsp);
         R_RenderBSPNode(numnodes - 1);
+        M_BenchStop(bench_bsp);
     }
     else
     {
@@ -499,10 +532,25 @@ void R_RenderPlayerView(player_t *player)
         if (player->cheats & CF_NOCLIP)
             V_FillRect(0, viewwindowx, viewwindowy, viewwidth, viewheight, 0);
 
+        R_BeginDrawQueue();
+
         // The head node is the last node output.
+        M_BenchStart(bench_bsp);
         R_RenderBSPNode(numnodes - 1);
+        M_BenchStop(bench_bsp);
 
+        M_BenchStart(bench_planes);
         R_DrawPlanes();
+        M_BenchStop(bench_planes);
+
+        M_BenchStart(bench_masked);
         R_DrawMasked();
+        R_FinishDrawQueue();
+
+        // draw the psprites on top of everything
+        R_DrawPlayerSprites();
+        M_BenchStop(bench_masked);
+
+        R_UpdateRenderStats();
     }
 }
@@ -56,6 +56,25 @@ extern fixed_t          projectiony;
 
 extern int              validcount;
 
+//
+// Renderer statistics.
+// How much of each of the renderer's growable arrays the last frame
+//  used, and the most that any frame has used.
+//
+typedef enum
+{
+    rs_drawsegs,
+    rs_vissprites,
+    rs_openings,
+    rs_visplanes,
+    NUMRENDERSTATS
+} renderstat_t;
+
+extern int              renderstats[NUMRENDERSTATS];
+extern int              renderpeaks[NUMRENDERSTATS];
+extern char             *renderstatnames[NUMRENDERSTATS];
+extern boolean          showrenderstats;
+
 extern int              linecount;
 extern int              loopcount;
 
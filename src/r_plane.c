@@ -26,6 +26,8 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
+#include <stdlib.h>
+
 #include "doomstat.h"
 #include "i_system.h"
 #include "r_local.h"
@@ -41,14 +43,21 @@ planefunction_t         ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES 1024
-visplane_t           visplanes[MAXVISPLANES];
-visplane_t           *lastvisplane;
+// Visplanes are hashed on (height, picnum, lightlevel), and allocated
+//  on demand from a free list that is refilled each frame.
+#define MAXVISPLANES 128        // must be a power of 2
+
+static visplane_t    *visplanes[MAXVISPLANES];
+static visplane_t    *freetail;
+static visplane_t    **freehead = &freetail;
 visplane_t           *floorplane;
 visplane_t           *ceilingplane;
+int                  numvisplanes;
+
+#define visplane_hash(picnum, lightlevel, height) \
+    ((unsigned int)((picnum) * 3 + (lightlevel) + ((height) >> FRACBITS) * 7) & (MAXVISPLANES - 1))
 
 // ?
-#define MAXOPENINGS  SCREENWIDTH * 64
 size_t               maxopenings;
 int                  *openings;
 int                  *lastopening;
@@ -119,7 +128,7 @@ static void R_MapPlane(int y, int x1, int x2)
     ds_x1 = x1;
     ds_x2 = x2;
 
-    spanfunc();
+    R_QueueSpan(spanfunc);
 }
 
 //
@@ -138,7 +147,12 @@ void R_ClearPlanes(void)
         ceilingclip[i] = -1;
     }
 
-    lastvisplane = visplanes;
+    // move all visplanes back onto the free list
+    for (i = 0; i < MAXVISPLANES; i++)
+        for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead;)
+            freehead = &(*freehead)->next;
+    numvisplanes = 0;
+
     lastopening = openings;
 
     // left to right mapping
@@ -149,27 +163,58 @@ void R_ClearPlanes(void)
     baseyscale = FixedDiv(viewcos, projection);
 }
 
+//
+// R_NewVisplane
+// Take a visplane off the free list, or allocate a new one, and add it
+//  to the given hash chain.
+//
+static visplane_t *R_NewVisplane(unsigned int hash)
+{
+    visplane_t  *check = freetail;
+
+    if (!check)
+    {
+        if (!(check = (visplane_t *)calloc(1, sizeof(*check))))
+            I_Error("R_NewVisplane: Failure trying to allocate %i bytes",
+                    (int)sizeof(*check));
+    }
+    else if (!(freetail = freetail->next))
+        freehead = &freetail;
+
+    check->next = visplanes[hash];
+    visplanes[hash] = check;
+    numvisplanes++;
+    return check;
+}
+
+//
+// R_ClearVisplaneColumns
+// A visplane's top array is only cleared as columns are added to it.
+//
+static void R_ClearVisplaneColumns(visplane_t *pl, int start, int stop)
+{
+    if (start <= stop)
+        memset(pl->top + start, 0xffff, (stop - start + 1) * sizeof(*pl->top));
+}
+
 //
 // R_FindPlane
 //
 visplane_t *R_FindPlane(fixed_t height, int picnum, int lightlevel)
 {
-    visplane_t *check;
+    visplane_t   *check;
+    unsigned int hash;
 
     if (picnum == skyflatnum)
         height = lightlevel = 0;        // all skys map together
 
-    for (check = visplanes; check < lastvisplane; check++)
-        if (height == check->height && picnum == check->picnum && lightlevel == check->lightlevel)
-            break;
-
-    if (check < lastvisplane)
-        return check;
+    hash = visplane_hash(picnum, lightlevel, height);
 
-    if (lastvisplane - visplanes == MAXVISPLANES)
-        I_Error("R_FindPlane: no more visplanes");
+    for (check = visplanes[hash]; check; check = check->next)
+        if (height == check->height && picnum == check->picnum && lightlevel == check->lightlevel)
+            return check;
 
-    lastvisplane++;
+    check = R_NewVisplane(hash);
 
     check->height = height;
     check->picnum = picnum;
@@ -177,8 +222,6 @@ visplane_t *R_FindPlane(fixed_t height, int picnum, int lightlevel)
     check->minx = viewwidth;
     check->maxx = -1;
 
-    memset(check->top, 0xffff, sizeof(check->top));
-
     return check;
 }
 
@@ -221,6 +264,15 @@ visplane_t *R_CheckPlane(visplane_t *pl, int start, int stop)
 
     if (x > intrh)
     {
+        // clear the columns the plane gains
+        if (pl->minx > pl->maxx)
+            R_ClearVisplaneColumns(pl, unionl, unionh);
+        else
+        {
+            R_ClearVisplaneColumns(pl, unionl, pl->minx - 1);
+            R_ClearVisplaneColumns(pl, pl->maxx + 1, unionh);
+        }
+
         pl->minx = unionl;
         pl->maxx = unionh;
 
@@ -229,15 +281,19 @@ visplane_t *R_CheckPlane(visplane_t *pl, int start, int stop)
     }
 
     // make a new visplane
-    lastvisplane->height = pl->height;
-    lastvisplane->picnum = pl->picnum;
-    lastvisplane->lightlevel = pl->lightlevel;
+    {
+        visplane_t  *new_pl = R_NewVisplane(visplane_hash(pl->picnum, pl->lightlevel, pl->height));
+
+        new_pl->height = pl->height;
+        new_pl->picnum = pl->picnum;
+        new_pl->lightlevel = pl->lightlevel;
+        pl = new_pl;
+    }
 
-    pl = lastvisplane++;
     pl->minx = start;
     pl->maxx = stop;
 
-    memset(pl->top, 0xffff, sizeof(pl->top));
+    R_ClearVisplaneColumns(pl, start, stop);
 
     return pl;
 }
@@ -277,13 +333,15 @@ void R_MakeSpans(int x, int t1, int b1, int t2, int b2)
 void R_DrawPlanes(void)
 {
     visplane_t *pl;
+    int        i;
     int        light;
     int        x;
     int        stop;
     int        angle;
     int        lumpnum;
 
-    for (pl = visplanes; pl < lastvisplane; pl++)
+    for (i = 0; i < MAXVISPLANES; i++)
+    for (pl = visplanes[i]; pl; pl = pl->next)
     {
         if (pl->minx > pl->maxx)
             continue;
@@ -300,6 +358,7 @@ void R_DrawPlanes(void)
 
             dc_colormap = (fixedcolormap ? fixedcolormap : colormaps); // [BH] So let's fix it...
             dc_texturemid = skytexturemid;
+            dc_walltier = WALLTIER_MID;
             for (x = pl->minx; x <= pl->maxx; x++)
             {
                 dc_yl = pl->top[x];
@@ -312,11 +371,12 @@ void R_DrawPlanes(void)
                     dc_source = R_GetColumn(skytexture, angle);
                     dc_texheight = textureheight[skytexture] >> FRACBITS;
                     if (flipsky)
-                        skycolfunc();
+                        R_QueueColumn(skycolfunc);
                     else
-                        wallcolfunc();
+                        R_QueueColumn(wallcolfunc);
                 }
             }
+            R_FlushWallColumns();
             continue;
         }
 
@@ -342,6 +402,6 @@ void R_DrawPlanes(void)
         for (x = pl->minx; x <= stop; x++)
             R_MakeSpans(x, pl->top[x - 1], pl->bottom[x - 1], pl->top[x], pl->bottom[x]);
 
-        W_ReleaseLumpNum(lumpnum);
+        R_ReleaseLumpAfterDraw(lumpnum);
     }
 }
\ No newline at end of file
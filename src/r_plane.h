@@ -35,8 +35,11 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 
 
 // Visplane related.
+extern  int             *openings;
 extern  int             *lastopening;
 
+extern  int             numvisplanes;
+
 
 typedef void (*planefunction_t)(int top, int bottom);
 
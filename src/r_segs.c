@@ -266,6 +266,7 @@ void R_RenderSegLoop(void)
         if (midtexture)
         {
             // single sided line
+            dc_walltier = WALLTIER_MID;
             dc_yl = yl;
             dc_yh = yh;
             dc_topsparkle = false;
@@ -274,9 +275,9 @@ void R_RenderSegLoop(void)
             dc_source = R_GetColumn(midtexture, texturecolumn);
             dc_texheight = textureheight[midtexture] >> FRACBITS;
             if (texturefullbright[midtexture] && !fixedcolormap)
-                fbwallcolfunc(texturefullbright[midtexture]);
+                R_QueueFullbrightColumn(fbwallcolfunc, texturefullbright[midtexture]);
             else
-                wallcolfunc();
+                R_QueueColumn(wallcolfunc);
             ceilingclip[rw_x] = viewheight;
             floorclip[rw_x] = -1;
         }
@@ -299,6 +300,7 @@ void R_RenderSegLoop(void)
 
                 if (mid >= yl)
                 {
+                    dc_walltier = WALLTIER_TOP;
                     dc_yl = yl;
                     dc_yh = mid;
                     dc_topsparkle = false;
@@ -307,9 +309,9 @@ void R_RenderSegLoop(void)
                     dc_source = R_GetColumn(toptexture, texturecolumn);
                     dc_texheight = textureheight[toptexture] >> FRACBITS;
                     if (texturefullbright[toptexture] && !fixedcolormap)
-                        fbwallcolfunc(texturefullbright[toptexture]);
+                        R_QueueFullbrightColumn(fbwallcolfunc, texturefullbright[toptexture]);
                     else
-                        wallcolfunc();
+                        R_QueueColumn(wallcolfunc);
                     ceilingclip[rw_x] = mid;
                 }
                 else
@@ -339,6 +341,7 @@ void R_RenderSegLoop(void)
 
                 if (mid <= yh)
                 {
+                    dc_walltier = WALLTIER_BOTTOM;
                     dc_yl = mid;
                     dc_yh = yh;
                     dc_topsparkle = (dc_topsparkle && dc_yh > dc_yl && rw_distance < (128 << FRACBITS));
@@ -347,9 +350,9 @@ void R_RenderSegLoop(void)
                     dc_source = R_GetColumn(bottomtexture, texturecolumn);
                     dc_texheight = textureheight[bottomtexture] >> FRACBITS;
                     if (texturefullbright[bottomtexture] && !fixedcolormap)
-                        fbwallcolfunc(texturefullbright[bottomtexture]);
+                        R_QueueFullbrightColumn(fbwallcolfunc, texturefullbright[bottomtexture]);
                     else
-                        wallcolfunc();
+                        R_QueueColumn(wallcolfunc);
                     floorclip[rw_x] = mid;
                 }
                 else
@@ -374,6 +377,8 @@ void R_RenderSegLoop(void)
         topfrac += topstep;
         bottomfrac += bottomstep;
     }
+
+    R_FlushWallColumns();
 }
 
 //
@@ -427,7 +432,6 @@ void R_StoreWallRange(int start, int stop)
 
     // killough 1/6/98, 2/1/98: remove limit on openings
     {
-        extern int    *openings;
         extern size_t maxopenings;
         size_t        pos = lastopening - openings;
         size_t        need = (rw_stopx - start) * 4 + pos;
@@ -230,7 +230,8 @@ void R_InitSpriteDefs(char **namelist)
 // GAME FUNCTIONS
 //
 static vissprite_t *vissprites, **vissprite_ptrs;       // killough
-static int num_vissprite, num_vissprite_alloc, num_vissprite_ptrs;
+static int num_vissprite_alloc, num_vissprite_ptrs;
+int num_vissprite;
 
 //
 // R_InitSprites
@@ -314,7 +315,7 @@ void R_DrawMaskedColumn1(column_t *column)
         {
             dc_source = (byte *)column + 3;
 
-            colfunc();
+            R_QueueColumn(colfunc);
         }
         column = (column_t *)((byte *)column + column->length + 4);
     }
@@ -367,14 +368,14 @@ void R_DrawMaskedColumn2(column_t *column)
         dc_source = (byte *)column + 3;
 
         if (dc_yl >= 0 && dc_yh < viewheight && dc_yl <= dc_yh)
-            colfunc();
+            R_QueueColumn(colfunc);
 
         column = (column_t *)((byte *)column + column->length + 4);
     }
 }
 
-boolean megasphere;
-int     fuzzpos;
+THREADLOCAL boolean megasphere;
+THREADLOCAL int     fuzzpos;
 
 //
 // R_DrawVisSprite
@@ -385,7 +386,8 @@ void R_DrawVisSprite(vissprite_t *vis, boolean psprite)
     column_t *column;
     int      texturecolumn;
     fixed_t  frac;
-    patch_t  *patch = (patch_t *)W_CacheLumpNum(vis->patch + firstspritelump, PU_CACHE);
+    int      lumpnum = vis->patch + firstspritelump;
+    patch_t  *patch = (patch_t *)W_CacheLumpNum(lumpnum, PU_STATIC);
 
     dc_colormap = vis->colormap;
 
@@ -441,6 +443,7 @@ void R_DrawVisSprite(vissprite_t *vis, boolean psprite)
         column = (column_t *)((byte *)patch + LONG(patch->columnofs[texturecolumn]));
         R_DrawMaskedColumn(column);
     }
+    R_ReleaseLumpAfterDraw(lumpnum);
 
     colfunc = basecolfunc;
 }
@@ -995,7 +998,4 @@ void R_DrawMasked(void)
     for (ds = ds_p; ds-- > drawsegs;)
         if (ds->maskedtexturecol)
             R_RenderMaskedSegRange(ds, ds->x1, ds->x2);
-
-    // draw the psprites on top of everything
-    R_DrawPlayerSprites();
 }
\ No newline at end of file
@@ -42,6 +42,8 @@ extern int              *mceilingclip;
 extern fixed_t          spryscale;
 extern fixed_t          sprtopscreen;
 
+extern int              num_vissprite;
+
 extern fixed_t          pspritexscale;
 extern fixed_t          pspriteyscale;
 extern fixed_t          pspriteiscale;
@@ -60,6 +62,7 @@ void R_DrawSprites(void);
 void R_InitSprites(char **namelist);
 void R_ClearSprites(void);
 void R_DrawMasked(void);
+void R_DrawPlayerSprites(void);
 
 void R_ClipVisSprite(vissprite_t *vis, int xl, int xh);
 
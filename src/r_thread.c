@@ -0,0 +1,446 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "r_local.h"
+#include "r_thread.h"
+#include "w_wad.h"
+
+//
+// The view is split into one vertical strip per thread. While the
+//  queue is open, every column or span that would be drawn is
+//  recorded along with the drawing state it needs, in the strip
+//  it falls in. Spans that cross a strip boundary are cut in two.
+// When the queue is finished, each strip replays its commands in
+//  order, so within a strip walls, planes and masked things are
+//  drawn exactly as they would have been without threads.
+//
+typedef enum
+{
+    DRAWCMD_COLUMN,
+    DRAWCMD_FULLBRIGHTCOLUMN,
+    DRAWCMD_SPAN
+} drawcmdtype_t;
+
+typedef struct
+{
+    void                (*func)(void);
+    void                (*fbfunc)(byte *);
+    byte                *fullbright;
+    lighttable_t        *colormap;
+    byte                *source;
+    byte                *translation;
+    int                 x;
+    int                 yl;
+    int                 yh;
+    fixed_t             iscale;
+    fixed_t             texturemid;
+    fixed_t             texheight;
+    fixed_t             texturefrac;
+    boolean             topsparkle;
+    boolean             bottomsparkle;
+    int                 walltier;
+    boolean             megasphere;
+} drawcolumn_t;
+
+typedef struct
+{
+    void                (*func)(void);
+    lighttable_t        *colormap;
+    byte                *source;
+    int                 y;
+    int                 x1;
+    int                 x2;
+    fixed_t             xfrac;
+    fixed_t             yfrac;
+    fixed_t             xstep;
+    fixed_t             ystep;
+} drawspan_t;
+
+typedef struct
+{
+    drawcmdtype_t       type;
+    union
+    {
+        drawcolumn_t    column;
+        drawspan_t      span;
+    } u;
+} drawcmd_t;
+
+typedef struct
+{
+    drawcmd_t           *cmds;
+    int                 numcmds;
+    int                 maxcmds;
+    int                 x1;
+    int                 x2;
+    SDL_sem             *start;
+    SDL_Thread          *thread;
+} drawstrip_t;
+
+int                     renderthreads = 1;
+
+static drawstrip_t      strips[MAXRENDERTHREADS];
+int                     numstrips = 1;
+static int              stripforx[MAXWIDTH];
+static int              stripwidth = -1;
+static SDL_sem          *stripsdone;
+static boolean          drawqueueing;
+
+// lumps that queued commands still read from
+static int              *queuedlumps;
+static int              numqueuedlumps;
+static int              maxqueuedlumps;
+
+void UnlockCPUAffinity(void);
+
+//
+// R_NewDrawCmd
+//
+static drawcmd_t *R_NewDrawCmd(drawstrip_t *strip, drawcmdtype_t type)
+{
+    drawcmd_t   *cmd;
+
+    if (strip->numcmds == strip->maxcmds)
+    {
+        strip->maxcmds = (strip->maxcmds ? strip->maxcmds * 2 : 4096);
+        strip->cmds = (drawcmd_t *)realloc(strip->cmds, strip->maxcmds * sizeof(*strip->cmds));
+        if (!strip->cmds)
+            I_Error("R_NewDrawCmd: Failure trying to allocate %i draw commands",
+                    strip->maxcmds);
+    }
+    cmd = &strip->cmds[strip->numcmds++];
+    cmd->type = type;
+    return cmd;
+}
+
+//
+// R_RecordColumn
+// Save the current column drawing state in the strip dc_x is in.
+//
+static drawcolumn_t *R_RecordColumn(drawcmdtype_t type)
+{
+    drawcolumn_t        *column = &R_NewDrawCmd(&strips[stripforx[dc_x]], type)->u.column;
+
+    column->colormap = dc_colormap;
+    column->source = dc_source;
+    column->translation = dc_translation;
+    column->x = dc_x;
+    column->yl = dc_yl;
+    column->yh = dc_yh;
+    column->iscale = dc_iscale;
+    column->texturemid = dc_texturemid;
+    column->texheight = dc_texheight;
+    column->texturefrac = dc_texturefrac;
+    column->topsparkle = dc_topsparkle;
+    column->bottomsparkle = dc_bottomsparkle;
+    column->walltier = dc_walltier;
+    column->megasphere = megasphere;
+    return column;
+}
+
+//
+// R_QueueColumn
+//
+void R_QueueColumn(void (*func)(void))
+{
+    if (drawqueueing)
+        R_RecordColumn(DRAWCMD_COLUMN)->func = func;
+    else
+        func();
+}
+
+//
+// R_QueueFullbrightColumn
+//
+void R_QueueFullbrightColumn(void (*func)(byte *), byte *fullbright)
+{
+    if (drawqueueing)
+    {
+        drawcolumn_t    *column = R_RecordColumn(DRAWCMD_FULLBRIGHTCOLUMN);
+
+        column->fbfunc = func;
+        column->fullbright = fullbright;
+    }
+    else
+        func(fullbright);
+}
+
+//
+// R_ReleaseLumpAfterDraw
+// A lump cached as PU_STATIC for drawing can't drop to PU_CACHE while
+//  commands reading it are still queued, as the zone may free it to
+//  make room before they are drawn. So it is held until the queue is
+//  finished.
+//
+void R_ReleaseLumpAfterDraw(int lumpnum)
+{
+    if (!drawqueueing)
+    {
+        W_ReleaseLumpNum(lumpnum);
+        return;
+    }
+
+    if (numqueuedlumps == maxqueuedlumps)
+    {
+        maxqueuedlumps = (maxqueuedlumps ? maxqueuedlumps * 2 : 256);
+        queuedlumps = (int *)realloc(queuedlumps, maxqueuedlumps * sizeof(*queuedlumps));
+        if (!queuedlumps)
+            I_Error("R_ReleaseLumpAfterDraw: Failure trying to allocate %i lumps",
+                    maxqueuedlumps);
+    }
+    queuedlumps[numqueuedlumps++] = lumpnum;
+}
+
+//
+// R_QueueSpan
+// The span is split at strip boundaries, with its texture
+//  coordinates stepped on to where each piece starts.
+//
+void R_QueueSpan(void (*func)(void))
+{
+    int i;
+    int last;
+
+    if (!drawqueueing)
+    {
+        func();
+        return;
+    }
+
+    last = stripforx[ds_x2];
+    for (i = stripforx[ds_x1]; i <= last; i++)
+    {
+        drawstrip_t *strip = &strips[i];
+        drawspan_t  *span = &R_NewDrawCmd(strip, DRAWCMD_SPAN)->u.span;
+        int         x1 = (ds_x1 > strip->x1 ? ds_x1 : strip->x1);
+
+        span->func = func;
+        span->colormap = ds_colormap;
+        span->source = ds_source;
+        span->y = ds_y;
+        span->x1 = x1;
+        span->x2 = (ds_x2 < strip->x2 ? ds_x2 : strip->x2);
+        span->xfrac = ds_xfrac + (x1 - ds_x1) * ds_xstep;
+        span->yfrac = ds_yfrac + (x1 - ds_x1) * ds_ystep;
+        span->xstep = ds_xstep;
+        span->ystep = ds_ystep;
+    }
+}
+
+//
+// R_DrawStrip
+// Replay a strip's commands using this thread's drawing state.
+//
+static void R_DrawStrip(drawstrip_t *strip)
+{
+    drawcmd_t   *cmd = strip->cmds;
+    drawcmd_t   *end = cmd + strip->numcmds;
+
+    for (; cmd < end; cmd++)
+    {
+        if (cmd->type == DRAWCMD_SPAN)
+        {
+            drawspan_t  *span = &cmd->u.span;
+
+            R_FlushWallColumns();
+
+            ds_colormap = span->colormap;
+            ds_source = span->source;
+            ds_y = span->y;
+            ds_x1 = span->x1;
+            ds_x2 = span->x2;
+            ds_xfrac = span->xfrac;
+            ds_yfrac = span->yfrac;
+            ds_xstep = span->xstep;
+            ds_ystep = span->ystep;
+            span->func();
+        }
+        else
+        {
+            drawcolumn_t        *column = &cmd->u.column;
+
+            dc_colormap = column->colormap;
+            dc_source = column->source;
+            dc_translation = column->translation;
+            dc_x = column->x;
+            dc_yl = column->yl;
+            dc_yh = column->yh;
+            dc_iscale = column->iscale;
+            dc_texturemid = column->texturemid;
+            dc_texheight = column->texheight;
+            dc_texturefrac = column->texturefrac;
+            dc_topsparkle = column->topsparkle;
+            dc_bottomsparkle = column->bottomsparkle;
+            dc_walltier = column->walltier;
+            megasphere = column->megasphere;
+
+            if (cmd->type == DRAWCMD_FULLBRIGHTCOLUMN)
+                column->fbfunc(column->fullbright);
+            else
+            {
+                if (column->func != R_DrawWallColumn)
+                    R_FlushWallColumns();
+
+                // give each column its own stretch of the fuzz table, so
+                //  strips never share entries and a paused frame redraws
+                //  the same way
+                if (column->func == fuzzcolfunc)
+                    fuzzpos = dc_x * SCREENHEIGHT;
+                column->func();
+            }
+        }
+    }
+    R_FlushWallColumns();
+    strip->numcmds = 0;
+}
+
+//
+// R_DrawThread
+//
+static int R_DrawThread(void *data)
+{
+    drawstrip_t *strip = (drawstrip_t *)data;
+
+    while (1)
+    {
+        SDL_SemWait(strip->start);
+        R_DrawStrip(strip);
+        SDL_SemPost(stripsdone);
+    }
+    return 0;
+}
+
+//
+// R_InitDrawThreads
+// Start the worker threads. The main thread draws the first strip
+//  itself, so renderthreads - 1 workers are created.
+//
+void R_InitDrawThreads(void)
+{
+    int threads = renderthreads;
+    int i;
+    int p;
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Draw the view with n threads (1 to 16), instead of the
+    // renderthreads setting in the config file.
+    //
+
+    p = M_CheckParmWithArgs("-renderthreads", 1);
+    if (p)
+        threads = atoi(myargv[p + 1]);
+
+    if (threads < 1)
+        threads = 1;
+    else if (threads > MAXRENDERTHREADS)
+        threads = MAXRENDERTHREADS;
+
+    if (threads == 1 || !(stripsdone = SDL_CreateSemaphore(0)))
+        return;
+
+    // i_main.c locks us to one core to work around SDL_mixer
+    UnlockCPUAffinity();
+
+    for (i = 1; i < threads; i++)
+    {
+        drawstrip_t     *strip = &strips[i];
+
+        if (!(strip->start = SDL_CreateSemaphore(0)))
+            break;
+        if (!(strip->thread = SDL_CreateThread(R_DrawThread, strip)))
+        {
+            SDL_DestroySemaphore(strip->start);
+            break;
+        }
+    }
+
+    // carry on with however many threads could be started
+    numstrips = i;
+}
+
+//
+// R_BeginDrawQueue
+// Called before the BSP walk.
+//
+void R_BeginDrawQueue(void)
+{
+    int i;
+    int x;
+
+    if (numstrips == 1)
+        return;
+
+    if (stripwidth != viewwidth)
+    {
+        stripwidth = viewwidth;
+        for (i = 0; i < numstrips; i++)
+        {
+            strips[i].x1 = viewwidth * i / numstrips;
+            strips[i].x2 = viewwidth * (i + 1) / numstrips - 1;
+            for (x = strips[i].x1; x <= strips[i].x2; x++)
+                stripforx[x] = i;
+        }
+    }
+    drawqueueing = true;
+}
+
+//
+// R_FinishDrawQueue
+// Draw all the strips, and wait for them to be done.
+//
+void R_FinishDrawQueue(void)
+{
+    int i;
+
+    if (!drawqueueing)
+        return;
+
+    drawqueueing = false;
+
+    for (i = 1; i < numstrips; i++)
+        SDL_SemPost(strips[i].start);
+
+    R_DrawStrip(&strips[0]);
+
+    for (i = 1; i < numstrips; i++)
+        SDL_SemWait(stripsdone);
+
+    for (i = 0; i < numqueuedlumps; i++)
+        W_ReleaseLumpNum(queuedlumps[i]);
+    numqueuedlumps = 0;
+}
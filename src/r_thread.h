@@ -0,0 +1,56 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#ifndef __R_THREAD__
+#define __R_THREAD__
+
+#include "doomtype.h"
+
+//
+// Threaded drawing.
+// The BSP walk, sprite sorting and clipping all run once on the
+//  main thread. Every column and span they would draw is instead
+//  queued for the vertical strip of the view it falls in, and the
+//  strips are then drawn in parallel, one per thread.
+//
+#define MAXRENDERTHREADS        16
+
+extern int              renderthreads;
+extern int              numstrips;              // how many threads are drawing
+
+void R_InitDrawThreads(void);
+
+void R_BeginDrawQueue(void);
+void R_FinishDrawQueue(void);
+
+void R_QueueColumn(void (*func)(void));
+void R_QueueFullbrightColumn(void (*func)(byte *), byte *fullbright);
+void R_QueueSpan(void (*func)(void));
+void R_ReleaseLumpAfterDraw(int lumpnum);
+
+#endif
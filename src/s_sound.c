@@ -40,6 +40,8 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 #include "m_random.h"
 #include "m_argv.h"
 
+#include "i_video.h"
+
 #include "p_local.h"
 #include "w_wad.h"
 #include "z_zone.h"
@@ -233,7 +235,7 @@ void S_Init(int sfxVolume, int musicVolume)
     // Disable all sound output.
     //
 
-    nosound = (M_CheckParm("-nosound") > 0);
+    nosound = (M_CheckParm("-nosound") > 0 || headless);
 
     //!
     // @vanilla
@@ -431,6 +433,20 @@ void S_StopSound(mobj_t *origin)
     }
 }
 
+// Is a sound still playing from <origin>?
+boolean S_OriginIsPlaying(mobj_t *origin)
+{
+    int cnum;
+
+    if (nosound || nosfx)
+        return false;
+
+    for (cnum = 0; cnum < numChannels; cnum++)
+        if (channels[cnum].sfxinfo && channels[cnum].origin == origin)
+            return true;
+    return false;
+}
+
 //
 // S_GetChannel :
 //   If none available, return -1.  Otherwise channel #.
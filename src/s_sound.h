@@ -178,6 +178,7 @@ void S_StartSound(void *origin, int sound_id);
 
 // Stop sound for thing at <origin>
 void S_StopSound(mobj_t *origin);
+boolean S_OriginIsPlaying(mobj_t *origin);
 void S_StopSounds(void);
 
 // Start music using <music_id> from sounds.h
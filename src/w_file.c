@@ -3,6 +3,7 @@
 
 DOOM RETRO
 A classic, refined DOOM source port. For Windows PC.
+
 Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
 Copyright  2005-2014 Simon Howard.
 Copyright  2013-2014 Brad Harding.
@@ -25,146 +26,53 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 ====================================================================
 */
 
-#include <stdio.h>
-
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-
 #include "doomtype.h"
-#include "m_argv.h"
-
-#include "i_system.h"
 #include "w_file.h"
-#include "z_zone.h"
 
-typedef struct
-{
-    wad_file_t wad;
-    HANDLE handle;
-    HANDLE handle_map;
-} win32_wad_file_t;
-
-wad_file_class_t win32_wad_file;
+extern wad_file_class_t win32_wad_file;
+extern wad_file_class_t posix_wad_file;
 
-static void MapFile(win32_wad_file_t *wad, char *filename)
+static wad_file_class_t *wad_file_classes[] =
 {
-    wad->handle_map = CreateFileMapping(wad->handle,
-                                        NULL,
-                                        PAGE_WRITECOPY,
-                                        0,
-                                        0,
-                                        NULL);
-
-    wad->wad.mapped = MapViewOfFile(wad->handle_map,
-                                    FILE_MAP_COPY,
-                                    0, 0, 0);
-}
-
-unsigned int GetFileLength(HANDLE handle)
-{
-    DWORD result;
-
-    result = SetFilePointer(handle, 0, NULL, FILE_END);
-
-    if (result == INVALID_SET_FILE_POINTER)
-    {
-        I_Error("W_Win32_OpenFile: Failed to read file length");
-    }
-
-    return result;
-}
+#ifdef _WIN32
+    &win32_wad_file,
+#else
+    &posix_wad_file,
+#endif
+};
 
 wad_file_t *W_OpenFile(char *path)
 {
-    win32_wad_file_t *result;
-    wchar_t wpath[MAX_PATH + 1];
-    HANDLE handle;
+    wad_file_t *result;
+    int i;
 
-    // Open the file:
+    // Try all classes in order until we find one that works
 
-    MultiByteToWideChar(CP_OEMCP, 0,
-                        path, strlen(path) + 1,
-                        wpath, sizeof(wpath));
+    result = NULL;
 
-    handle = CreateFileW(wpath,
-                         GENERIC_READ,
-                         FILE_SHARE_READ,
-                         NULL,
-                         OPEN_EXISTING,
-                         FILE_ATTRIBUTE_NORMAL,
-                         NULL);
-
-    if (handle == INVALID_HANDLE_VALUE)
+    for (i = 0; i < arrlen(wad_file_classes); ++i)
     {
-        return NULL;
-    }
-
-    // Create a new win32_wad_file_t to hold the file handle.
+        result = wad_file_classes[i]->OpenFile(path);
 
-    result = (win32_wad_file_t *)Z_Malloc(sizeof(win32_wad_file_t), PU_STATIC, 0);
-    result->wad.file_class = &win32_wad_file;
-    result->wad.length = GetFileLength(handle);
-    result->handle = handle;
-
-    // Try to map the file into memory with mmap:
-
-    MapFile(result, path);
+        if (result != NULL)
+            break;
+    }
 
-    return &result->wad;
+    return result;
 }
 
 void W_CloseFile(wad_file_t *wad)
 {
-    win32_wad_file_t *win32_wad;
-
-    win32_wad = (win32_wad_file_t *)wad;
-
-    // If mapped, unmap it.
-
-    if (win32_wad->wad.mapped != NULL)
-    {
-        UnmapViewOfFile(win32_wad->wad.mapped);
-    }
-
-    if (win32_wad->handle_map != NULL)
-    {
-        CloseHandle(win32_wad->handle_map);
-    }
-
-    // Close the file
-
-    if (win32_wad->handle != NULL)
-    {
-        CloseHandle(win32_wad->handle);
-    }
-
-    Z_Free(win32_wad);
+    wad->file_class->CloseFile(wad);
 }
 
-
 size_t W_Read(wad_file_t *wad, unsigned int offset, void *buffer, size_t buffer_len)
 {
-    win32_wad_file_t *win32_wad;
-    DWORD bytes_read;
-    DWORD result;
-
-    win32_wad = (win32_wad_file_t *)wad;
-
-    // Jump to the specified position in the file.
-
-    result = SetFilePointer(win32_wad->handle, offset, NULL, FILE_BEGIN);
-
-    if (result == INVALID_SET_FILE_POINTER)
-    {
-        I_Error("W_Win32_Read: Failed to set file pointer to %i", offset);
-    }
-
-    // Read into the buffer.
-
-    if (!ReadFile(win32_wad->handle, buffer, buffer_len, &bytes_read, NULL))
-    {
-        I_Error("W_Win32_Read: Error reading from file");
-    }
+    return wad->file_class->Read(wad, offset, buffer, buffer_len);
+}
 
-    return bytes_read;
-}
\ No newline at end of file
+void W_Prefetch(wad_file_t *wad, unsigned int offset, size_t len)
+{
+    if (wad->mapped != NULL && wad->file_class->Prefetch != NULL)
+        wad->file_class->Prefetch(wad, offset, len);
+}
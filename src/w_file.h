@@ -49,6 +49,11 @@ typedef struct
     size_t (*Read)(wad_file_t *file, unsigned int offset,
                    void *buffer, size_t buffer_len);
 
+    // Hint that the specified range of a mapped file is about to be
+    // read, so it can be paged in ahead of time. May be NULL.
+
+    void (*Prefetch)(wad_file_t *file, unsigned int offset, size_t len);
+
 } wad_file_class_t;
 
 struct _wad_file_s
@@ -83,4 +88,9 @@ void W_CloseFile(wad_file_t *wad);
 size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len);
 
+// Hint that the specified range of a memory-mapped WAD file will be
+// needed soon.
+
+void W_Prefetch(wad_file_t *wad, unsigned int offset, size_t len);
+
 #endif /* #ifndef __W_FILE__ */
\ No newline at end of file
@@ -0,0 +1,229 @@
+/*
+====================================================================
+
+DOOM RETRO
+A classic, refined DOOM source port. For Windows PC.
+
+Copyright  1993-1996 id Software LLC, a ZeniMax Media company.
+Copyright  2005-2014 Simon Howard.
+Copyright  2013-2014 Brad Harding.
+
+This file is part of DOOM RETRO.
+
+DOOM RETRO is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+DOOM RETRO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
+
+====================================================================
+*/
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+typedef struct
+{
+    wad_file_t wad;
+    int handle;
+} posix_wad_file_t;
+
+extern wad_file_class_t posix_wad_file;
+
+static void MapFile(posix_wad_file_t *wad, char *filename)
+{
+    void *result;
+
+    // Map privately and writable, as the Win32 version does with
+    // FILE_MAP_COPY: some lumps are byteswapped or fixed up in place
+    // after loading, and those changes must never reach the file.
+
+    result = mmap(NULL, wad->wad.length,
+                  PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                  wad->handle, 0);
+
+    if (result == MAP_FAILED)
+    {
+        fprintf(stderr, "W_POSIX_OpenFile: Unable to mmap() %s - %s\n",
+                filename, strerror(errno));
+        return;
+    }
+
+    wad->wad.mapped = (byte *)result;
+
+    // Lumps are looked up in no particular order, so stop the kernel
+    // from reading ahead on every page fault. The ranges that are
+    // known to be needed soon are asked for through W_Prefetch.
+
+    madvise(result, wad->wad.length, MADV_RANDOM);
+}
+
+static unsigned int GetFileLength(int handle)
+{
+    struct stat buf;
+
+    if (fstat(handle, &buf) < 0)
+    {
+        I_Error("W_POSIX_OpenFile: Failed to read file length");
+    }
+
+    return buf.st_size;
+}
+
+static wad_file_t *W_POSIX_OpenFile(char *path)
+{
+    posix_wad_file_t *result;
+    int handle;
+
+    // Open the file:
+
+    handle = open(path, O_RDONLY);
+
+    if (handle < 0)
+    {
+        return NULL;
+    }
+
+    // Create a new posix_wad_file_t to hold the file handle.
+
+    result = (posix_wad_file_t *)Z_Malloc(sizeof(posix_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &posix_wad_file;
+    result->wad.mapped = NULL;
+    result->wad.length = GetFileLength(handle);
+    result->handle = handle;
+
+    // Try to map the file into memory with mmap:
+
+    if (result->wad.length > 0)
+    {
+        MapFile(result, path);
+    }
+
+    return &result->wad;
+}
+
+static void W_POSIX_CloseFile(wad_file_t *wad)
+{
+    posix_wad_file_t *posix_wad;
+
+    posix_wad = (posix_wad_file_t *)wad;
+
+    // If mapped, unmap it.
+
+    if (posix_wad->wad.mapped != NULL)
+    {
+        munmap(posix_wad->wad.mapped, posix_wad->wad.length);
+    }
+
+    // Close the file
+
+    close(posix_wad->handle);
+
+    Z_Free(posix_wad);
+}
+
+static size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
+                           void *buffer, size_t buffer_len)
+{
+    posix_wad_file_t *posix_wad;
+    byte *byte_buffer;
+    size_t bytes_read;
+    ssize_t result;
+
+    posix_wad = (posix_wad_file_t *)wad;
+
+    // Jump to the specified position in the file.
+
+    if (lseek(posix_wad->handle, offset, SEEK_SET) < 0)
+    {
+        I_Error("W_POSIX_Read: Failed to set file pointer to %i", offset);
+    }
+
+    // Read into the buffer.
+
+    bytes_read = 0;
+    byte_buffer = (byte *)buffer;
+
+    while (buffer_len > 0)
+    {
+        result = read(posix_wad->handle, byte_buffer, buffer_len);
+
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            I_Error("W_POSIX_Read: Error reading from file");
+        }
+
+        // End of file?
+
+        if (result == 0)
+        {
+            break;
+        }
+
+        byte_buffer += result;
+        buffer_len -= result;
+        bytes_read += result;
+    }
+
+    return bytes_read;
+}
+
+static void W_POSIX_Prefetch(wad_file_t *wad, unsigned int offset, size_t len)
+{
+    static size_t pagesize;
+    size_t start;
+    size_t end;
+
+    if (!pagesize)
+    {
+        pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    }
+
+    // madvise() wants a page-aligned address. The mapping itself
+    // starts on a page boundary, so round the offset down.
+
+    start = offset & ~(pagesize - 1);
+    end = (size_t)offset + len;
+
+    if (end > wad->length)
+    {
+        end = wad->length;
+    }
+
+    if (end > start)
+    {
+        madvise(wad->mapped + start, end - start, MADV_WILLNEED);
+    }
+}
+
+wad_file_class_t posix_wad_file =
+{
+    W_POSIX_OpenFile,
+    W_POSIX_CloseFile,
+    W_POSIX_Read,
+    W_POSIX_Prefetch
+};
+
+#endif /* #ifndef _WIN32 */
@@ -416,6 +416,25 @@ void *W_CacheLumpNum(int lumpnum, int tag)
     return result;
 }
 
+//
+// W_PrefetchLumpNum
+//
+// Hint that a lump is about to be used. If it is in a memory-mapped
+// file, its pages are read in ahead of the first access rather than
+// being faulted in one at a time.
+//
+void W_PrefetchLumpNum(int lumpnum)
+{
+    lumpinfo_t  *lump;
+
+    if ((unsigned)lumpnum >= numlumps)
+        return;
+
+    lump = &lumpinfo[lumpnum];
+
+    W_Prefetch(lump->wad_file, lump->position, lump->size);
+}
+
 //
 // W_CacheLumpName
 //
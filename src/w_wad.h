@@ -81,6 +81,7 @@ void W_ReadLump(unsigned int lump, void *dest);
 
 void *W_CacheLumpNum(int lump, int tag);
 void *W_CacheLumpName(char *name, int tag);
+void W_PrefetchLumpNum(int lump);
 
 void W_GenerateHashTable(void);
 
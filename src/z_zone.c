@@ -52,6 +52,12 @@ along with DOOM RETRO. If not, see http://www.gnu.org/licenses/.
 // Number of mallocs & frees kept in history buffer (must be a power of 2)
 #define ZONE_HISTORY            4
 
+// Largest block that is kept on a free list for reuse instead of being freed
+#define SMALL_BLOCK_SIZE        1024
+
+// Most memory that can be kept on the free lists at once
+#define MAX_IDLE_MEMORY         (4 * 1024 * 1024)
+
 // End Tunables
 
 typedef struct memblock
@@ -73,10 +79,55 @@ static const size_t     HEADER_SIZE = (sizeof(memblock_t) + CHUNK_SIZE - 1)
 
 static memblock_t       *blockbytag[PU_MAX];
 
+// Small blocks that have been freed are kept on a list for their size class
+//  (one per CHUNK_SIZE), so that things like puffs, blood splats and
+//  missiles being spawned and removed don't go through malloc() and free()
+//  each time.
+#define NUMSIZECLASSES          (SMALL_BLOCK_SIZE / CHUNK_SIZE)
+
+static memblock_t       *freeblocks[NUMSIZECLASSES];
+static size_t           idle_memory = 0;
+
+// Statistics for -zonestats
+boolean                 zonestats = false;
+
+static size_t           tagblocks[PU_MAX];
+static size_t           tagbytes[PU_MAX];
+static size_t           inuse_memory = 0;
+static size_t           peak_memory = 0;
+static size_t           peak_idle_memory = 0;
+static uint32_t         mallocs = 0;
+static uint32_t         reused = 0;
+static uint32_t         frees = 0;
+
 // 0 means unlimited, any other value is a hard limit
 static int32_t          memory_size = 0;
 static int32_t          free_memory = 0;
 
+//
+// Z_FreeIdleBlocks
+// Give the blocks kept on the free lists back to the system.
+//
+static void Z_FreeIdleBlocks(void)
+{
+    int32_t i;
+
+    for (i = 0; i < NUMSIZECLASSES; ++i)
+    {
+        memblock_t *block = freeblocks[i];
+
+        while (block)
+        {
+            memblock_t *next = block->next;
+
+            free(block);
+            block = next;
+        }
+        freeblocks[i] = NULL;
+    }
+    idle_memory = 0;
+}
+
 //
 // Z_Malloc
 // You can pass a NULL user if the tag is < PU_PURGELEVEL.
@@ -125,14 +176,31 @@ void *Z_Malloc(size_t size, int32_t tag, void **user)
         block = NULL;
     }
 
-    while (!(block = (memblock_t *)malloc(size + HEADER_SIZE)))
+    ++mallocs;
+
+    if (size <= SMALL_BLOCK_SIZE && freeblocks[size / CHUNK_SIZE - 1])
+    {
+        block = freeblocks[size / CHUNK_SIZE - 1];
+        freeblocks[size / CHUNK_SIZE - 1] = block->next;
+        idle_memory -= size + HEADER_SIZE;
+        ++reused;
+    }
+    else
     {
-        if (!blockbytag[PU_CACHE])
+        while (!(block = (memblock_t *)malloc(size + HEADER_SIZE)))
         {
-            I_Error("Z_Malloc: Failure trying to allocate %lu bytes",
-                    (uint32_t)size);
+            if (idle_memory)
+            {
+                Z_FreeIdleBlocks();
+                continue;
+            }
+            if (!blockbytag[PU_CACHE])
+            {
+                I_Error("Z_Malloc: Failure trying to allocate %lu bytes",
+                        (uint32_t)size);
+            }
+            Z_FreeTags(PU_CACHE, PU_CACHE);
         }
-        Z_FreeTags(PU_CACHE, PU_CACHE);
     }
 
     if (!blockbytag[tag])
@@ -152,6 +220,14 @@ void *Z_Malloc(size_t size, int32_t tag, void **user)
 
     free_memory -= block->size;
 
+    ++tagblocks[tag];
+    tagbytes[tag] += size;
+    inuse_memory += size + HEADER_SIZE;
+    if (inuse_memory > peak_memory)
+    {
+        peak_memory = inuse_memory;
+    }
+
     block->tag = tag; // tag
     block->user = user; // user
     block = (memblock_t *)((char *)block + HEADER_SIZE);
@@ -190,7 +266,30 @@ void Z_Free(void *p)
 
     free_memory += block->size;
 
-    free(block);
+    ++frees;
+    --tagblocks[block->tag];
+    tagbytes[block->tag] -= block->size;
+    inuse_memory -= block->size + HEADER_SIZE;
+
+    if (block->size <= SMALL_BLOCK_SIZE
+        && idle_memory + block->size + HEADER_SIZE <= MAX_IDLE_MEMORY)
+    {
+        int32_t sizeclass = block->size / CHUNK_SIZE - 1;
+
+        block->tag = PU_FREE;
+        block->user = NULL;
+        block->next = freeblocks[sizeclass];
+        freeblocks[sizeclass] = block;
+        idle_memory += block->size + HEADER_SIZE;
+        if (idle_memory > peak_idle_memory)
+        {
+            peak_idle_memory = idle_memory;
+        }
+    }
+    else
+    {
+        free(block);
+    }
 }
 
 void Z_FreeTags(int32_t lowtag, int32_t hightag)
@@ -252,6 +351,11 @@ void Z_ChangeTag(void *ptr, int32_t tag)
     block->prev->next = block->next;
     block->next->prev = block->prev;
 
+    --tagblocks[block->tag];
+    tagbytes[block->tag] -= block->size;
+    ++tagblocks[tag];
+    tagbytes[tag] += block->size;
+
     if (!blockbytag[tag])
     {
         blockbytag[tag] = block;
@@ -293,4 +397,30 @@ void *Z_Calloc(size_t n1, size_t n2, int32_t tag, void **user)
 char *Z_Strdup(const char *s, int32_t tag, void **user)
 {
     return strcpy((char *)Z_Malloc(strlen(s) + 1, tag, user), s);
-}
\ No newline at end of file
+}
+
+//
+// Z_PrintStats
+// Report how the zone is being used, for -zonestats.
+//
+void Z_PrintStats(void)
+{
+    static char *tagnames[PU_MAX] =
+    {
+        "free", "static", "sound", "music", "level", "levspec", "cache"
+    };
+    size_t      held = inuse_memory + idle_memory;
+    int32_t     i;
+
+    printf("Zone memory:\n");
+    for (i = PU_FREE + 1; i < PU_MAX; ++i)
+        printf("  %-8s %8lu blocks %10lu bytes\n", tagnames[i],
+               (uint32_t)tagblocks[i], (uint32_t)tagbytes[i]);
+    printf("  in use   %10lu bytes (peak %lu)\n",
+           (uint32_t)inuse_memory, (uint32_t)peak_memory);
+    printf("  idle     %10lu bytes (peak %lu) on free lists, %.1f%% of memory held\n",
+           (uint32_t)idle_memory, (uint32_t)peak_idle_memory,
+           (held ? 100.0 * idle_memory / held : 0.0));
+    printf("  %lu allocations, %lu reused from free lists (%.1f%%), %lu frees\n",
+           mallocs, reused, (mallocs ? 100.0 * reused / mallocs : 0.0), frees);
+}
@@ -64,5 +64,8 @@ void Z_ChangeTag(void *ptr, int32_t tag);
 void *Z_Calloc(size_t n1, size_t n2, int32_t tag, void **user);
 void *Z_Realloc(void *ptr, size_t n, int32_t tag, void **user);
 char *Z_Strdup(const char *s, int32_t tag, void **user);
+void Z_PrintStats(void);
+
+extern boolean zonestats;
 
 #endif
\ No newline at end of file